@@ -0,0 +1,155 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "alloc_stats.h"
+#include "ast.h"
+#include "compiler.h"
+#include "environment.h"
+#include "eval.h"
+#include "lexer.h"
+#include "parser.h"
+#include "parth_error.h"
+#include "source.h"
+#include "vm.h"
+
+/* The scripts in bench/corpus, each run through every phase on its own, so a
+ * change to the lexer, parser, evaluator or VM shows up under that phase only.
+ * Each one reports its time per run (ns/op) and the allocations it made per
+ * run (allocs/op). They're registered as Corpus/<script>/<phase>, so
+ *
+ *     bin/runBench --benchmark_filter=Corpus/.*\/eval
+ *
+ * runs just the evaluator over all of them. The paths are relative to the
+ * root of the repo, which is where `make bench` runs from. */
+
+#ifndef CORPUS_DIR
+#define CORPUS_DIR "bench/corpus"
+#endif
+
+namespace {
+
+// What each script is there to stress
+const char *CORPUS[] = {
+    "fib",           // deep recursion, an environment per call
+    "range_map",     // map() over a large range
+    "word_count",    // walking a string, map reads and writes
+    "string_build",  // concatenation in a loop
+    "closures",      // making and calling lots of small functions
+};
+
+// Loads the script, or marks the benchmark as failed if it isn't there
+bool load(benchmark::State &state, const std::string &name,
+          std::string &text) {
+  try {
+    SourceFile source = SourceFile(CORPUS_DIR "/" + name + ".parth");
+    text = std::string(source.text());
+    return true;
+  } catch (const SourceException &e) {
+    state.SkipWithError(e.what());
+    return false;
+  }
+}
+
+ast::block_ptr parse(const std::string &text) {
+  Lexer lexer = Lexer(text);
+  Parser parser = Parser(&lexer);
+  return parser.parse_program();
+}
+
+void report(benchmark::State &state, const stats::Allocations &before) {
+  stats::Allocations used = stats::allocations() - before;
+  state.counters["allocs/op"] = benchmark::Counter(
+      double(used.allocs), benchmark::Counter::kAvgIterations);
+}
+
+void lex_phase(benchmark::State &state, const std::string &name) {
+  std::string text;
+  if (!load(state, name, text)) return;
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    Lexer lexer = Lexer(text);
+    while (lexer.next_token().get_type() != TokenType::EOF_VAL) {
+    }
+  }
+  report(state, before);
+}
+
+// The parser pulls tokens as it goes, so this includes lexing. Subtract the
+// lex phase to get the parser on its own.
+void parse_phase(benchmark::State &state, const std::string &name) {
+  std::string text;
+  if (!load(state, name, text)) return;
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(parse(text));
+  }
+  report(state, before);
+}
+
+void eval_phase(benchmark::State &state, const std::string &name) {
+  std::string text;
+  if (!load(state, name, text)) return;
+  ast::block_ptr program = parse(text);
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  report(state, before);
+}
+
+void compile_phase(benchmark::State &state, const std::string &name) {
+  std::string text;
+  if (!load(state, name, text)) return;
+  ast::block_ptr program = parse(text);
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    vm::Compiler compiler = vm::Compiler();
+    benchmark::DoNotOptimize(compiler.compile_program(program));
+  }
+  report(state, before);
+}
+
+void run_phase(benchmark::State &state, const std::string &name) {
+  std::string text;
+  if (!load(state, name, text)) return;
+  vm::Compiler compiler = vm::Compiler();
+  vm::proto_ptr proto = compiler.compile_program(parse(text));
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(vm::execute(*proto, envir));
+  }
+  report(state, before);
+}
+
+// Google Benchmark's own main() runs whatever's registered by then, so this
+// has to happen during static initialization
+int register_corpus() {
+  struct Phase {
+    const char *name;
+    void (*fn)(benchmark::State &, const std::string &);
+  };
+  const Phase phases[] = {
+      {"lex", &lex_phase},         {"parse", &parse_phase},
+      {"eval", &eval_phase},       {"compile", &compile_phase},
+      {"run", &run_phase},
+  };
+
+  for (const char *script : CORPUS) {
+    for (const Phase &phase : phases) {
+      std::string label = std::string("Corpus/") + script + "/" + phase.name;
+      benchmark::RegisterBenchmark(label.c_str(), phase.fn,
+                                   std::string(script));
+    }
+  }
+  return 0;
+}
+
+const int registered = register_corpus();
+
+}  // namespace
@@ -0,0 +1,266 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include "alloc_stats.h"
+#include "ast.h"
+#include "environment.h"
+#include "eval.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "parser.h"
+
+static ast::block_ptr parse_bench_input(const std::string &input) {
+  Lexer lexer = Lexer(input);
+  Parser parser = Parser(&lexer);
+  return parser.parse_program();
+}
+
+// A wide, flat expression so nearly all the work is dispatching on nodes:
+// 1 + 2 + 3 + ... is an infix node and an integer node per term
+static std::string flat_sum(int terms) {
+  std::string input = "1";
+  for (int i = 2; i <= terms; i++) {
+    input += " + " + std::to_string(i % 100);
+  }
+  return input;
+}
+
+static void count_nodes(ast::node_ptr node, std::vector<ast::node_ptr> &out) {
+  out.push_back(node);
+  if (node->_type() == ast::INFIX) {
+    ast::infix_ptr infix = fast_cast<ast::Infix>(node);
+    count_nodes(infix->left, out);
+    count_nodes(infix->right, out);
+  }
+}
+
+// The two ways eval() can get from a node to its concrete type once the switch
+// has decided what it is. The difference between them is the per-node cost of
+// checking that with RTTI. Build with `make bench RELEASE=1` to see what the
+// interpreter actually pays, since debug builds keep the check in fast_cast.
+
+static void BM_NodeDynamicCast(benchmark::State &state) {
+  std::vector<ast::node_ptr> nodes;
+  count_nodes(parse_bench_input(flat_sum(1000))->nodes[0], nodes);
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (auto &node : nodes) {
+      if (node->_type() == ast::INTEGER) {
+        sum += std::dynamic_pointer_cast<ast::Integer>(node)->value;
+      } else {
+        sum += std::dynamic_pointer_cast<ast::Infix>(node)->op.get_line();
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_NodeDynamicCast);
+
+static void BM_NodeFastCast(benchmark::State &state) {
+  std::vector<ast::node_ptr> nodes;
+  count_nodes(parse_bench_input(flat_sum(1000))->nodes[0], nodes);
+
+  for (auto _ : state) {
+    int64_t sum = 0;
+    for (auto &node : nodes) {
+      if (node->_type() == ast::INTEGER) {
+        sum += fast_cast<ast::Integer>(node)->value;
+      } else {
+        sum += fast_cast<ast::Infix>(node)->op.get_line();
+      }
+    }
+    benchmark::DoNotOptimize(sum);
+  }
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_NodeFastCast);
+
+// The same expression through eval(), reported per node
+static void BM_EvalFlatSum(benchmark::State &state) {
+  ast::block_ptr program = parse_bench_input(flat_sum(1000));
+  std::vector<ast::node_ptr> nodes;
+  count_nodes(program->nodes[0], nodes);
+
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  state.SetItemsProcessed(state.iterations() * nodes.size());
+}
+BENCHMARK(BM_EvalFlatSum);
+
+// Function call overhead: each iteration of the range is two calls (the
+// callback, then f), so this is mostly argument passing and binding
+static void BM_FunctionCall(benchmark::State &state) {
+  ast::block_ptr program = parse_bench_input(
+      "let f = (a, b, c) => { a }\n"
+      "each(1..10000, (x) => { f(x, x, x) })\n");
+
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  state.SetItemsProcessed(state.iterations() * 20000);
+}
+BENCHMARK(BM_FunctionCall);
+
+// Recursion goes through the same path, with deeper environments
+static void BM_RecursiveFib(benchmark::State &state) {
+  ast::block_ptr program = parse_bench_input(
+      "let fib = (n) => {\n"
+      "  if (n < 2) { return n }\n"
+      "  fib(n - 1) + fib(n - 2)\n"
+      "}\n"
+      "fib(18)\n");
+
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+}
+BENCHMARK(BM_RecursiveFib);
+
+// Walking a long string character by character, with allocations per
+// character as a counter. The characters themselves are shared, so what's left
+// is the call itself.
+static void BM_EachOverString(benchmark::State &state) {
+  ast::block_ptr program = parse_bench_input(
+      "let hits = 0\n"
+      "each(text, (c) => { if (c == \"a\") { hits = hits + 1 } })\n");
+  obj::str_ptr text =
+      obj::str_ptr(new obj::String(std::string(state.range(0), 'a')));
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    envir->init("text", obj::Value(text));
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  stats::Allocations used = stats::allocations() - before;
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+  state.counters["allocs/char"] =
+      double(used.allocs) / (state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EachOverString)->Arg(100000);
+
+// A callback that ignores its arguments, over a range well past the small int
+// cache, with allocations per step as a counter. The bounds and the arguments
+// stay unboxed, so what's left is the call's own environment.
+static void BM_EachOverRange(benchmark::State &state) {
+  ast::block_ptr program = parse_bench_input(
+      "each(100000..200000, (x, i) => { true })\n");
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  stats::Allocations used = stats::allocations() - before;
+  state.SetItemsProcessed(state.iterations() * 100001);
+  state.counters["allocs/step"] =
+      double(used.allocs) / (state.iterations() * 100001);
+}
+BENCHMARK(BM_EachOverRange);
+
+// map() over a 10M element range, which is mostly about what each step costs
+// besides the callback: filling the argument frame and keeping the result
+static void BM_MapLargeRange(benchmark::State &state) {
+  ast::block_ptr program = parse_bench_input(
+      "map(1..10000000, (x) => { x })\n");
+
+  stats::Allocations before = stats::allocations();
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  stats::Allocations used = stats::allocations() - before;
+  state.SetItemsProcessed(state.iterations() * 10000000);
+  state.counters["allocs/step"] =
+      double(used.allocs) / (state.iterations() * 10000000);
+}
+BENCHMARK(BM_MapLargeRange)->Unit(benchmark::kMillisecond);
+
+// map() against pmap() over a callback that does enough work to be worth
+// splitting up. How far apart they are depends on how many cores there are.
+static void run_heavy_callback(benchmark::State &state, const char *fn) {
+  ast::block_ptr program = parse_bench_input(
+      "let step = (x) => { (x * 31 + 7) * (x + 3) * 2 + x * x - x }\n" +
+      std::string(fn) + "(1..100000, step)\n");
+
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  state.SetItemsProcessed(state.iterations() * 100000);
+}
+
+static void BM_MapHeavyCallback(benchmark::State &state) {
+  run_heavy_callback(state, "map");
+}
+BENCHMARK(BM_MapHeavyCallback)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+static void BM_PmapHeavyCallback(benchmark::State &state) {
+  run_heavy_callback(state, "pmap");
+}
+BENCHMARK(BM_PmapHeavyCallback)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+// A whole script (lexed, parsed and run) on its own Interpreter in each
+// thread. Nothing the threads write to is shared, so as long as there are
+// enough cores, the time per script should hold steady as threads are added.
+static void BM_InterpreterPerThread(benchmark::State &state) {
+  const std::string script =
+      "let fib = (n) => {\n"
+      "  if (n < 2) { return n }\n"
+      "  fib(n - 1) + fib(n - 2)\n"
+      "}\n"
+      "let words = {}\n"
+      "each(1..500, (i) => { words[i % 13] = [i, \"w\"] })\n"
+      "fib(14) + len(words)\n";
+
+  for (auto _ : state) {
+    Interpreter interpreter;
+    benchmark::DoNotOptimize(interpreter.run(script));
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_InterpreterPerThread)->ThreadRange(1, 8)->UseRealTime();
+
+// A host running the same small script over and over with different inputs,
+// either from the source every time or from a program compiled once
+static const char *REQUEST_SCRIPT =
+    "let total = 0\n"
+    "each(items, (item) => { total = total + item * rate })\n"
+    "total\n";
+
+static bindings request_inputs(int64_t rate) {
+  obj::obj_list items;
+  for (int i = 0; i < 20; i++) {
+    items.push_back(obj::make_integer(i));
+  }
+  return bindings{{"items", obj::arr_ptr(new obj::List(items))},
+                  {"rate", obj::Value::integer(rate)}};
+}
+
+static void BM_RequestFromSource(benchmark::State &state) {
+  bindings inputs = request_inputs(3);
+  for (auto _ : state) {
+    Interpreter interpreter;
+    for (const auto &input : inputs) {
+      interpreter.bind(input.first, input.second);
+    }
+    benchmark::DoNotOptimize(interpreter.run(REQUEST_SCRIPT));
+  }
+}
+BENCHMARK(BM_RequestFromSource);
+
+static void BM_RequestCompiled(benchmark::State &state) {
+  program_ptr program = Program::compile(REQUEST_SCRIPT);
+  bindings inputs = request_inputs(3);
+  Interpreter interpreter;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(interpreter.execute(program, inputs));
+  }
+}
+BENCHMARK(BM_RequestCompiled);
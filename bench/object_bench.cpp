@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+#include <memory>
+#include <string>
+#include "environment.h"
+#include "eval.h"
+#include "lexer.h"
+#include "object.h"
+#include "parser.h"
+
+// Creating a temporary is what arithmetic and iteration do on every step.
+// Hashing it right after is what every creation used to cost back when hashes
+// were computed eagerly, so the difference between each pair is the per-op
+// saving of lazy hashing.
+
+static void BM_IntegerCreate(benchmark::State &state) {
+  int64_t i = 0;
+  for (auto _ : state) {
+    obj::int_ptr num = obj::int_ptr(new obj::Integer(i++));
+    benchmark::DoNotOptimize(num);
+  }
+}
+BENCHMARK(BM_IntegerCreate);
+
+static void BM_IntegerCreateAndHash(benchmark::State &state) {
+  int64_t i = 0;
+  for (auto _ : state) {
+    obj::int_ptr num = obj::int_ptr(new obj::Integer(i++));
+    benchmark::DoNotOptimize(num->hash());
+  }
+}
+BENCHMARK(BM_IntegerCreateAndHash);
+
+static void BM_StringCreate(benchmark::State &state) {
+  std::string str(state.range(0), 'a');
+  for (auto _ : state) {
+    obj::str_ptr s = obj::str_ptr(new obj::String(str));
+    benchmark::DoNotOptimize(s);
+  }
+}
+BENCHMARK(BM_StringCreate)->Arg(1)->Arg(64);
+
+static void BM_StringCreateAndHash(benchmark::State &state) {
+  std::string str(state.range(0), 'a');
+  for (auto _ : state) {
+    obj::str_ptr s = obj::str_ptr(new obj::String(str));
+    benchmark::DoNotOptimize(s->hash());
+  }
+}
+BENCHMARK(BM_StringCreateAndHash)->Arg(1)->Arg(64);
+
+// A whole arithmetic-heavy loop, reported per iteration of the range
+static void BM_ArithmeticLoop(benchmark::State &state) {
+  const std::string input =
+      "let total = 0\n"
+      "each(1..10000, (x, i) => { total = total + x * 2 - i % 3 })\n";
+  Lexer lexer = Lexer(input);
+  Parser parser = Parser(&lexer);
+  ast::block_ptr program = parser.parse_program();
+
+  for (auto _ : state) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    benchmark::DoNotOptimize(eval(program, envir));
+  }
+  state.SetItemsProcessed(state.iterations() * 10000);
+}
+BENCHMARK(BM_ArithmeticLoop);
+
+// Building a map one key at a time and then reading every key back, reported
+// per key
+static void BM_MapInsertAndFind(benchmark::State &state) {
+  int64_t size = state.range(0);
+  obj::obj_list keys;
+  for (int64_t i = 0; i < size; i++) {
+    keys.push_back(obj::str_ptr(new obj::String("key" + std::to_string(i))));
+  }
+
+  for (auto _ : state) {
+    obj::obj_map map;
+    for (const obj::obj_ptr &key : keys) {
+      map.insert(key, key);
+    }
+    for (const obj::obj_ptr &key : keys) {
+      benchmark::DoNotOptimize(map.find(key));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * size);
+}
+BENCHMARK(BM_MapInsertAndFind)->Arg(16)->Arg(10000);
+
+// Looking up a map by a long list key. The key's hash is only worked out on
+// the first lookup, so this should stay flat as the key grows.
+static void BM_MapListKeyLookup(benchmark::State &state) {
+  obj::obj_list values;
+  for (int64_t i = 0; i < state.range(0); i++) {
+    values.push_back(obj::make_integer(i));
+  }
+  obj::obj_ptr key = obj::arr_ptr(new obj::List(values));
+  obj::obj_map map;
+  map.insert(key, key);
+
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(map.find(key));
+  }
+}
+BENCHMARK(BM_MapListKeyLookup)->Arg(8)->Arg(1000);
+
+// Building a string with + one piece at a time and then reading it once,
+// reported per piece
+static void BM_StringBuild(benchmark::State &state) {
+  obj::str_ptr piece = obj::str_ptr(new obj::String("some text, "));
+  for (auto _ : state) {
+    obj::str_ptr built = obj::str_ptr(new obj::String(""));
+    for (int64_t i = 0; i < state.range(0); i++) {
+      built = obj::String::concat(built, piece);
+    }
+    benchmark::DoNotOptimize(built->hash());
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_StringBuild)->Arg(100)->Arg(10000);
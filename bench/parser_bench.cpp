@@ -0,0 +1,49 @@
+#include <benchmark/benchmark.h>
+#include <string>
+#include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "token.h"
+
+// A few thousand lines of the kind of code a script is made of, reported per
+// node so it can be compared across inputs
+static std::string large_script(int lines) {
+  std::string input;
+  for (int i = 0; i < lines; i++) {
+    std::string n = std::to_string(i);
+    input += "let f" + n + " = (a, b) => { if (a > b) { a } else { [b, " + n +
+             ", \"s\"] } }\n";
+  }
+  return input;
+}
+
+static void BM_ParseLargeScript(benchmark::State &state) {
+  std::string input = large_script(state.range(0));
+  size_t nodes = 0;
+
+  for (auto _ : state) {
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(&lexer);
+    ast::block_ptr program = parser.parse_program();
+    nodes = parser.get_arena()->allocation_count();
+    benchmark::DoNotOptimize(program);
+  }
+  state.SetItemsProcessed(state.iterations() * nodes);
+}
+BENCHMARK(BM_ParseLargeScript)->Arg(100)->Arg(2000);
+
+// Lexing on its own, in bytes per second. Identifiers repeat across lines like
+// they do in a real script, so most of the interning is a hit.
+static void BM_LexLargeScript(benchmark::State &state) {
+  std::string input = large_script(state.range(0));
+
+  for (auto _ : state) {
+    Lexer lexer = Lexer(input);
+    for (Token tok = lexer.next_token(); tok.get_type() != TokenType::EOF_VAL;
+         tok = lexer.next_token()) {
+      benchmark::DoNotOptimize(tok);
+    }
+  }
+  state.SetBytesProcessed(state.iterations() * input.size());
+}
+BENCHMARK(BM_LexLargeScript)->Arg(2000);
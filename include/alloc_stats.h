@@ -0,0 +1,141 @@
+#ifndef ALLOC_STATS_H
+#define ALLOC_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace stats {
+
+/* Allocation counters:
+ * Every heap allocation made through operator new is counted, so the CLI and
+ * benchmarks can report how many allocations a phase of a script costs. The
+ * counts only ever go up; take a snapshot before and after and subtract.
+ *
+ * The counting is done by replacing the global operator new, which is in
+ * count_new.cpp, and only linked into parth itself, the tests and the
+ * benchmarks (see LIBOBJECTS in the makefile). A program that embeds the
+ * interpreter keeps its own allocator, and these counts stay at zero. */
+struct Allocations {
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t bytes;
+
+  Allocations operator-(const Allocations &other) const;
+  std::string to_string() const;
+};
+
+Allocations allocations();
+
+/* Object counters:
+ * The same idea, but by what was made rather than by raw allocation: every
+ * kind of object (one per obj::obj_type) and environments. A class is counted
+ * by deriving from Counted, which adds nothing to its size. Only the objects
+ * themselves are counted, so a string's bytes don't include its text and a
+ * list's don't include its elements.
+ *
+ * The kinds are plain numbers here so that object.h can use this header.
+ * Objects use their obj_type, and environments come right after the last. */
+const size_t MAX_KINDS = 16;
+
+/* ThreadCounts:
+ * Both kinds of counts are kept per thread, so that threads making objects at
+ * once (pmap, or interpreters on separate threads) aren't all fighting over
+ * the same few cache lines. Only the thread itself adds to its counts, which
+ * makes adding a plain load and store; they're only atomic so that another
+ * thread can read them. Reading adds up every thread's counts, including
+ * those of threads that have since finished.
+ *
+ * A thread can free what another made, so its own live count (allocs less
+ * frees) can go below zero. The peak reported is the sum of each thread's own
+ * peak, which is exact when everything happens on one thread and otherwise
+ * errs high. */
+struct ThreadCounts {
+  std::atomic<uint64_t> new_allocs;
+  std::atomic<uint64_t> new_frees;
+  std::atomic<uint64_t> new_bytes;
+  std::atomic<uint64_t> allocs[MAX_KINDS];
+  std::atomic<uint64_t> frees[MAX_KINDS];
+  std::atomic<int64_t> peak[MAX_KINDS];
+
+  // The other threads' counts, see alloc_stats.cpp
+  ThreadCounts *next;
+  bool enlisted;
+};
+
+// Nothing but zeroes to start with, so it's ready without any setup, even
+// inside operator new
+inline thread_local ThreadCounts thread_counts;
+
+// Makes this thread's counts visible to the others, the first time it counts
+// anything
+void enlist(ThreadCounts &counts);
+
+inline ThreadCounts &local_counts() {
+  ThreadCounts &counts = thread_counts;
+  if (!counts.enlisted) {
+    enlist(counts);
+  }
+  return counts;
+}
+
+template <typename T>
+inline void bump(std::atomic<T> &count, T by = 1) {
+  count.store(count.load(std::memory_order_relaxed) + by,
+              std::memory_order_relaxed);
+}
+
+// What count_new.cpp calls
+inline void count_new(size_t bytes) {
+  ThreadCounts &counts = local_counts();
+  bump<uint64_t>(counts.new_allocs);
+  bump<uint64_t>(counts.new_bytes, bytes);
+}
+
+inline void count_delete() { bump<uint64_t>(local_counts().new_frees); }
+
+inline void count_alloc(size_t kind) {
+  ThreadCounts &counts = local_counts();
+  bump<uint64_t>(counts.allocs[kind]);
+  int64_t live = counts.allocs[kind].load(std::memory_order_relaxed) -
+                 counts.frees[kind].load(std::memory_order_relaxed);
+  if (live > counts.peak[kind].load(std::memory_order_relaxed)) {
+    counts.peak[kind].store(live, std::memory_order_relaxed);
+  }
+}
+
+inline void count_free(size_t kind) {
+  bump<uint64_t>(local_counts().frees[kind]);
+}
+
+// Every object of a kind is the same size, so only the counts are kept and the
+// bytes are worked out when they're asked for
+template <size_t KIND>
+class Counted {
+ protected:
+  Counted() { count_alloc(KIND); }
+  Counted(const Counted &) { count_alloc(KIND); }
+  ~Counted() { count_free(KIND); }
+};
+
+struct KindStats {
+  std::string kind;
+  uint64_t allocs;
+  uint64_t frees;
+  uint64_t live_bytes;
+  uint64_t peak_bytes;
+};
+
+// Every kind that's been made at least once
+std::vector<KindStats> objects();
+// Just the one kind (by the name objects() gives it), or all zeroes if none
+// have been made
+KindStats objects_of(const std::string &kind);
+// A table of the above, one kind per line
+std::string objects_report();
+
+}  // namespace stats
+
+#endif
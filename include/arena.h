@@ -0,0 +1,81 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace ast {
+
+/* Arena:
+ * A bump allocator for the nodes of a parsed program. Nodes are carved out of
+ * a few large chunks instead of being allocated one at a time, so nodes parsed
+ * together sit next to each other in memory. Nothing is freed on its own; the
+ * chunks all go away together once the last node made in the arena is gone.
+ *
+ * Only the nodes themselves live here. What they hold is still allocated on
+ * its own: the vectors of a block, list, call or function, names and strings
+ * too long to fit in place, and the constant a string literal is made into.
+ * So parsing still costs allocations, just not one per node. */
+class Arena {
+ public:
+  Arena();
+  ~Arena();
+
+  Arena(const Arena &) = delete;
+  Arena &operator=(const Arena &) = delete;
+
+  void *allocate(size_t size, size_t align);
+
+  size_t chunk_count() const { return chunks.size(); }
+  size_t allocation_count() const { return allocations; }
+
+ private:
+  // Big enough that most scripts fit in one or two
+  static const size_t CHUNK_SIZE = 32 * 1024;
+
+  std::vector<char *> chunks;
+  size_t chunk_used;
+  size_t chunk_size;
+  size_t allocations;
+};
+
+typedef std::shared_ptr<Arena> arena_ptr;
+
+/* ArenaAllocator:
+ * Lets std::allocate_shared put a node (and its refcount) in an arena, so the
+ * nodes keep their regular shared_ptr handles. Every node holds on to the
+ * arena through its allocator, which is what keeps the arena around for as
+ * long as any node from it is, even one that was pulled out of the tree (like
+ * the body of a function object). */
+template <typename T>
+class ArenaAllocator {
+ public:
+  typedef T value_type;
+
+  explicit ArenaAllocator(const arena_ptr &arena) : arena(arena) {}
+  template <typename U>
+  ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena) {}
+
+  T *allocate(size_t n) {
+    return static_cast<T *>(arena->allocate(n * sizeof(T), alignof(T)));
+  }
+  // Freed along with the rest of the arena
+  void deallocate(T *, size_t) {}
+
+  arena_ptr arena;
+};
+
+template <typename T, typename U>
+bool operator==(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.arena == b.arena;
+}
+
+template <typename T, typename U>
+bool operator!=(const ArenaAllocator<T> &a, const ArenaAllocator<U> &b) {
+  return a.arena != b.arena;
+}
+
+}  // namespace ast
+
+#endif
@@ -34,6 +34,15 @@ enum node_type {
 };
 
 std::string node_type_string(node_type);
+}  // namespace ast
+
+// Literal nodes hold on to the object they evaluate to
+namespace obj {
+class Integer;
+class String;
+}  // namespace obj
+
+namespace ast {
 
 class Node;
 class Block;
@@ -87,6 +96,8 @@ typedef std::vector<kv_pair> kv_list;
  * interpreted as another node. A node will always evaluate to a value */
 class Node {
  public:
+  // The token the node starts at, which is also how the evaluator (and the
+  // sampler) knows what line it's on
   Token token;
   virtual std::string token_literal() { return token.get_literal(); };
   virtual std::string to_string() = 0;
@@ -110,6 +121,11 @@ class Block : public Node {
   Block(Token token);
 
   node_list nodes;
+  // The number of variable slots in the scope this block opens, filled in by
+  // the Resolver. Only function bodies open a scope with slots, so this stays 0
+  // for the program (whose globals are kept by name) and for the blocks of an
+  // if-else, which share their enclosing scope.
+  size_t slot_count;
 
   std::string to_string();
   void push_node(node_ptr node);
@@ -124,8 +140,20 @@ class Identifier : public Node {
  public:
   Identifier(Token token, std::string value);
 
-  Token token;
   std::string value;
+  // The interned name, which is what environments and the Resolver go by
+  symbol_id symbol;
+  // Where the variable lives, filled in by the Resolver: how many scopes out
+  // from the current one, and which slot in that scope. A depth of -1 means it
+  // wasn't resolved (globals, builtins, or names only known at runtime), and
+  // it has to be looked up by name.
+  int depth;
+  int slot;
+  // The same name declared in scopes further out, innermost first, as (depth,
+  // slot). A function can be called before its own scope gets to the `let`
+  // the name resolved to, and then it sees the nearest of these that's been
+  // declared, or failing that the global, the same as it would by name.
+  std::vector<std::pair<int, int>> shadows;
 
   std::string to_string();
   node_type _type();
@@ -142,7 +170,6 @@ class Let : public Node {
   Let(Token token, ident_ptr name);
   Let(Token token, ident_ptr name, node_ptr expression);
 
-  Token token;
   const ident_ptr name;
   node_ptr expression;
 
@@ -157,7 +184,6 @@ class Assign : public Node {
  public:
   Assign(Token token, ident_ptr name, node_ptr expression);
 
-  Token token;
   ident_ptr name;
   node_ptr expression;
 
@@ -174,7 +200,6 @@ class Return : public Node {
  public:
   Return(Token token, node_ptr expression);
 
-  Token token;
   node_ptr expression;
 
   std::string to_string();
@@ -188,8 +213,13 @@ class Integer : public Node {
  public:
   Integer(Token token, int64_t value);
 
-  Token token;
   int64_t value;
+  // The digits as written. The token comes pointing into the source, and is
+  // pointed here instead so that it doesn't dangle once the source is gone.
+  std::string text;
+  // Made once when the literal is parsed, and handed out every time it's
+  // evaluated. Integers are immutable, so sharing it is safe.
+  std::shared_ptr<obj::Integer> constant;
 
   std::string to_string();
   node_type _type();
@@ -202,7 +232,6 @@ class Bool : public Node {
  public:
   Bool(Token token, bool value);
 
-  Token token;
   bool value;
 
   std::string to_string();
@@ -221,7 +250,6 @@ class Option : public Identifier {
  public:
   Option(Token token, std::string name);
 
-  Token token;
   std::string value;
 
   std::string to_string();
@@ -235,8 +263,10 @@ class String : public Node {
  public:
   String(Token token, std::string value);
 
-  Token token;
+  // Also what the token points at, like Integer::text
   std::string value;
+  // Same as Integer::constant, since strings can't be changed in place either
+  std::shared_ptr<obj::String> constant;
 
   std::string to_string();
   node_type _type();
@@ -249,7 +279,6 @@ class List : public Node {
  public:
   List(Token token, node_list values);
 
-  Token token;
   node_list values;
 
   std::string to_string();
@@ -271,7 +300,6 @@ class Map : public Node {
  public:
   Map(Token token);
 
-  Token token;
   kv_list key_value_pairs;
 
   std::string to_string();
@@ -287,7 +315,6 @@ class Prefix : public Node {
  public:
   Prefix(Token token, Token op, node_ptr right);
 
-  Token token;
   Token op;
   node_ptr right;
 
@@ -303,7 +330,6 @@ class Infix : public Node {
  public:
   Infix(Token token, Token op, node_ptr left, node_ptr right);
 
-  Token token;
   Token op;
   node_ptr left;
   node_ptr right;
@@ -320,7 +346,6 @@ class Group : public Node {
  public:
   Group(Token token, node_ptr expr);
 
-  Token token;
   node_ptr expr;
 
   std::string to_string();
@@ -352,7 +377,6 @@ class IfElse : public Node {
  public:
   IfElse(Token token);
 
-  Token token;
   std::vector<condition_set> list;
 
   std::string to_string();
@@ -370,7 +394,6 @@ class Function : public Node {
  public:
   Function(Token token, param_list params, block_ptr body);
 
-  Token token;
   param_list params;
   block_ptr body;
 
@@ -389,7 +412,6 @@ class Call : public Node {
  public:
   Call(Token token, node_ptr function, node_list args);
 
-  Token token;
   node_ptr function;
   node_list args;
 
@@ -414,7 +436,6 @@ class Index : public Node {
  public:
   Index(Token token, node_ptr left, node_ptr index);
 
-  Token token;
   node_ptr left;
   node_ptr index;
 
@@ -427,13 +448,14 @@ class Index : public Node {
  * about this, please let me know. This feels weirdly tedious. */
 class NullNodeException : public std::exception {
  public:
-  NullNodeException(std::string opt = "") { this->opt = opt; }
+  NullNodeException(std::string opt = "")
+      : opt(opt),
+        message((opt.empty() ? "" : opt + " ") +
+                "NullNodeException: A null node member was passed to a node "
+                "object method or constructor") {}
   std::string opt;
-  virtual const char *what() const throw() {
-    std::cout << opt << std::endl;
-    return "NullNodeException: A null node member was passed to a node object "
-           "method or constructor";
-  }
+  std::string message;
+  virtual const char *what() const throw() { return message.c_str(); }
 };
 
 /* The to_string method of the IfElse will throw this if called when the
@@ -447,4 +469,4 @@ class EmptyConditionListException : public std::exception {
 
 }  // namespace ast
 
-#endif
\ No newline at end of file
+#endif
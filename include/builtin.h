@@ -7,36 +7,55 @@
 #include "eval.h"
 #include "object.h"
 #include "parth_error.h"
+#include "symbol.h"
 
-typedef obj::obj_ptr (*BI)(obj::obj_list);
-typedef std::unordered_map<std::string, BI> builtin_map;
+typedef obj::obj_ptr (*BI)(const obj::obj_list &);
+typedef std::unordered_map<symbol_id, BI> builtin_map;
 
 class Builtins {
  public:
-  static bool is_builtin(std::string);
-  static BI get_builtin(std::string);
+  static bool is_builtin(symbol_id);
+  static bool is_builtin(const std::string&);
+  static BI get_builtin(symbol_id);
+  static BI get_builtin(const std::string&);
 
  private:
-  static builtin_map all_builtins;
+  static const builtin_map all_builtins;
 };
 
-obj::obj_ptr len(obj::obj_list);
-obj::obj_ptr print(obj::obj_list);
-obj::obj_ptr hash(obj::obj_list);
-obj::obj_ptr each(obj::obj_list);
-obj::obj_ptr map(obj::obj_list);
+obj::obj_ptr len(const obj::obj_list&);
+obj::obj_ptr print(const obj::obj_list&);
+obj::obj_ptr hash(const obj::obj_list&);
+obj::obj_ptr each(const obj::obj_list&);
+obj::obj_ptr map(const obj::obj_list&);
+obj::obj_ptr pmap(const obj::obj_list&);
+obj::obj_ptr object_stats(const obj::obj_list&);
+
+// The pool pmap spreads its calls over. Unless one is set, that's the shared
+// pool, or none at all on a single core. One that is set gets used even there,
+// which is how the tests make sure pmap really runs on several threads on any
+// machine. Passing nullptr goes back to the default.
+class ThreadPool;
+void set_pmap_pool(ThreadPool*);
 
 // Helpers
 
-obj::obj_ptr iterate_over(obj::obj_list, bool);
-obj::obj_ptr iterate_list(obj::arr_ptr, obj::obj_ptr, obj::obj_list&, bool);
-obj::obj_ptr iterate_string(obj::str_ptr, obj::obj_ptr, obj::obj_list&, bool);
-obj::obj_ptr iterate_range(obj::range_ptr, obj::obj_ptr, obj::obj_list&, bool);
-obj::obj_ptr iterate_map(obj::map_ptr, obj::obj_ptr, obj::obj_list&, bool);
-
-// Also including the global constant objects here since they are builtin values
-const obj::bool_ptr TRUE_OBJ = obj::bool_ptr(new obj::Bool(true));
-const obj::bool_ptr FALSE_OBJ = obj::bool_ptr(new obj::Bool(false));
-const obj::opt_ptr NONE_OBJ = obj::opt_ptr(new obj::Option());
+obj::obj_ptr iterate_over(const obj::obj_list&, bool);
+obj::obj_ptr iterate_list(const obj::arr_ptr&, const obj::obj_ptr&,
+                          obj::obj_list&, bool);
+obj::obj_ptr iterate_string(const obj::str_ptr&, const obj::obj_ptr&,
+                            obj::obj_list&, bool);
+obj::obj_ptr iterate_range(const obj::range_ptr&, const obj::obj_ptr&,
+                           obj::obj_list&, bool);
+obj::obj_ptr iterate_map(const obj::map_ptr&, const obj::obj_ptr&,
+                         obj::obj_list&, bool);
+
+// Also including the global constant objects here since they are builtin
+// values. They're defined once in builtin.cpp, since a const defined in the
+// header would give every translation unit its own copy, and singletons are
+// compared by pointer.
+extern const obj::bool_ptr TRUE_OBJ;
+extern const obj::bool_ptr FALSE_OBJ;
+extern const obj::opt_ptr NONE_OBJ;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,101 @@
+#ifndef BYTECODE_H
+#define BYTECODE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "object.h"
+#include "token.h"
+#include "value.h"
+
+namespace vm {
+
+// Every instruction is a single opcode with at most one operand. What the
+// operand means depends on the opcode (constant index, name index, jump
+// target, argument count...), and it's simply ignored by the ones that take
+// nothing. The comment next to each opcode shows its effect on the stack.
+enum OpCode : uint8_t {
+  OP_CONSTANT = 0,  // -> constants[arg]
+  OP_TRUE,          // -> TRUE_OBJ
+  OP_FALSE,         // -> FALSE_OBJ
+  OP_NONE,          // -> NONE_OBJ
+  OP_POP,           // x ->
+
+  OP_GET_NAME,    // -> value of names[arg]
+  OP_SET_NAME,    // x -> x, reassigns names[arg]
+  OP_GET_VAR,     // -> value of vars[arg]
+  OP_SET_VAR,     // x -> x, reassigns vars[arg]
+  OP_LET,         // x -> x, initializes vars[arg]
+  OP_LET_OPTION,  // x -> ?(x), initializes vars[arg]
+  OP_LET_NONE,    // -> NONE_OBJ, initializes vars[arg]
+
+  OP_INFIX,       // left right -> result of tokens[arg]
+  OP_PREFIX,      // right -> result of tokens[arg]
+  OP_LIST,        // arg values -> list
+  OP_MAP,         // arg key/value pairs -> map
+  OP_INDEX,       // left index -> value
+  OP_INDEX_SET,   // left index value -> value
+  OP_WRAP_OPTION, // x -> ?(x)
+
+  OP_JUMP,           // jumps to arg
+  OP_JUMP_IF_FALSE,  // x -> , jumps to arg if x is falsy
+
+  // Nothing on the stack. Marks the start of a statement on line arg, for the
+  // sampler (see sampler.h).
+  OP_LINE,
+
+  OP_CLOSURE,  // -> function made from protos[arg]
+  OP_CALL,     // callable arg args -> result
+  // x -> , leaves the current proto. An arg of 1 marks an explicit `return`,
+  // while 0 is the implicit one at the end of every proto
+  OP_RETURN,
+};
+
+std::string opcode_string(OpCode);
+
+struct Instruction {
+  OpCode op;
+  uint32_t arg;
+};
+
+typedef std::vector<Instruction> code_list;
+
+// A variable as placed by the Resolver. Unresolved ones (globals) have a slot
+// of -1 and go by name instead. The name is kept either way for errors.
+struct VarRef {
+  int depth;
+  int slot;
+  symbol_id name;
+  // See ast::Identifier::shadows
+  std::vector<std::pair<int, int>> shadows;
+};
+
+/* Proto:
+ * The compiled form of a block of code, either the top level program or the
+ * body of a function literal. Function literals inside of it are compiled to
+ * their own protos once, and every closure created from that literal shares
+ * it. */
+struct Proto {
+  code_list code;
+  obj::value_list constants;
+  // Identifiers that have to be looked up by name
+  std::vector<symbol_id> names;
+  // Identifiers the Resolver gave a slot, plus everything declared by `let`
+  std::vector<VarRef> vars;
+  // Operator tokens are kept around for dispatch and error locations
+  std::vector<Token> tokens;
+  std::vector<ast::func_ptr> functions;
+  std::vector<proto_ptr> protos;
+  // The deepest the value stack gets, so it can be reserved up front
+  size_t max_stack = 0;
+  // Only the top level proto wraps a `return` in a ReturnVal, to match what
+  // eval() gives back for the whole program
+  bool is_script = false;
+
+  std::string disassemble();
+};
+
+}  // namespace vm
+
+#endif
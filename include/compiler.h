@@ -0,0 +1,50 @@
+#ifndef COMPILER_H
+#define COMPILER_H
+
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "ast.h"
+#include "builtin.h"
+#include "bytecode.h"
+#include "object.h"
+#include "parth_error.h"
+
+namespace vm {
+
+/* The compiler flattens an AST into a Proto that the VM can run without
+ * walking (and casting) nodes. It's a single pass over the tree, emitting
+ * instructions for each node in the same order that eval() would evaluate
+ * them, so both give the same results (and the same side effects). */
+class Compiler {
+ public:
+  Compiler();
+
+  proto_ptr compile_program(ast::block_ptr program);
+  proto_ptr compile_function(ast::func_ptr func_node);
+
+ private:
+  proto_ptr proto;
+  // Tracks the stack depth while emitting so max_stack can be filled in
+  size_t depth;
+  std::unordered_map<symbol_id, uint32_t> name_indices;
+
+  void compile(ast::node_ptr node);
+  void compile_block(ast::block_ptr block);
+  void compile_let(ast::let_ptr let);
+  void compile_infix(ast::infix_ptr infix);
+  void compile_if_else(ast::ifelse_ptr if_else);
+
+  uint32_t emit(OpCode op, uint32_t arg, int stack_effect);
+  void patch_jump(uint32_t at);
+  uint32_t add_constant(obj::Value constant);
+  uint32_t add_name(symbol_id name);
+  uint32_t add_var(ast::ident_ptr ident);
+  void emit_get(ast::ident_ptr ident);
+  void emit_set(ast::ident_ptr ident);
+  uint32_t add_token(const Token &token);
+};
+
+}  // namespace vm
+
+#endif
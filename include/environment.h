@@ -4,8 +4,12 @@
 #include <memory>
 #include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 #include "object.h"
 #include "parth_error.h"
+#include "symbol.h"
+#include "value.h"
 
 namespace env {
 
@@ -13,17 +17,58 @@ class Environment;
 
 typedef std::shared_ptr<Environment> env_ptr;
 
-class Environment {
+// Environments are counted (see alloc_stats.h) as the kind after the last
+// object type
+const size_t ENV_KIND = obj::ERROR + 1;
+
+class Environment : stats::Counted<ENV_KIND> {
  public:
   Environment();
   Environment(env_ptr);
-  std::unordered_map<std::string, obj::obj_ptr> store;
+  // Sizes the slots up front for a scope laid out by the Resolver
+  Environment(env_ptr, size_t slot_count);
+
+  // Variables the Resolver placed ahead of time. An empty value means the
+  // variable hasn't been initialized yet.
+  obj::value_list slots;
+  // Variables that could only be known by name (set up from outside the
+  // program, or never resolved). Values rather than objects, so that the VM
+  // can store and load numbers without boxing them. Objects passed in are
+  // kept as-is, so ::get gives back the very same object that was stored.
+  // Keyed by interned name, so lookups hash an integer rather than a string.
+  std::unordered_map<symbol_id, obj::Value> store;
   env_ptr outer;
 
-  void init(const std::string&, obj::obj_ptr);
-  void set(const std::string&, obj::obj_ptr);
-  obj::obj_ptr get(const std::string);
+  // Slot access. The name is only used for error messages, and for when the
+  // slot hasn't been initialized yet, in which case ::set goes to the same
+  // name further out instead (see ast::Identifier::shadows).
+  void init(size_t slot, symbol_id, obj::Value);
+  void set(size_t depth, size_t slot, symbol_id, obj::Value,
+           const std::vector<std::pair<int, int>> &shadows);
+  // Gives an empty value if the slot isn't initialized
+  obj::Value get_value(size_t depth, size_t slot);
+  // What to read instead when that happens: the nearest of the shadowed
+  // slots that is initialized, or else the name. Empty if none of them are.
+  obj::Value get_shadowed(symbol_id,
+                          const std::vector<std::pair<int, int>> &shadows);
+
+  // Name access
+  void init(symbol_id, obj::Value);
+  void set(symbol_id, obj::Value);
+  // Gives an empty value if there's no such variable
+  obj::Value get_value(symbol_id);
+
+  // Name access for when all there is is the text of the name. These intern it
+  // first, then work just like the ones above.
+  void init(const std::string&, obj::Value);
+  void set(const std::string&, obj::Value);
+  obj::obj_ptr get(const std::string&);
+  // Like ::get, but without boxing
+  obj::Value get_value(const std::string&);
   void inspect();
+
+ private:
+  Environment* scope_at(size_t depth);
 };
 
 }  // namespace env
@@ -8,44 +8,79 @@
 #include "environment.h"
 #include "object.h"
 #include "parth_error.h"
+#include "profile.h"
+#include "sampler.h"
 #include "util.h"
+#include "value.h"
+#include "vm.h"
 
-obj::obj_ptr eval(ast::node_ptr, env::env_ptr);
+obj::obj_ptr eval(const ast::node_ptr&, const env::env_ptr&);
+// Leaves numbers unboxed on their way through arithmetic, see eval.cpp
+obj::Value evalValue(const ast::node_ptr&, const env::env_ptr&);
 
-obj::obj_ptr evalBlock(ast::block_ptr, env::env_ptr);
-obj::obj_ptr evalIdent(ast::ident_ptr, env::env_ptr);
-obj::obj_ptr evalLet(ast::let_ptr, env::env_ptr);
-obj::obj_ptr evalIdentLet(ast::let_ptr, env::env_ptr);
-obj::obj_ptr evalOptLet(ast::let_ptr, env::env_ptr);
-obj::int_ptr evalInteger(ast::int_ptr);
-obj::bool_ptr evalBool(ast::bool_ptr);
-obj::opt_ptr evalOption(ast::opt_ptr, env::env_ptr);
-obj::str_ptr evalString(ast::str_ptr);
-obj::arr_ptr evalList(ast::arr_ptr, env::env_ptr);
-obj::map_ptr evalMap(ast::map_ptr, env::env_ptr);
-obj::func_ptr evalFunctionLiteral(ast::func_ptr, env::env_ptr);
-obj::obj_ptr evalInfix(ast::infix_ptr, env::env_ptr);
-obj::obj_ptr evalPrefix(ast::prefix_ptr, env::env_ptr);
-obj::obj_ptr evalAssign(ast::ident_ptr, ast::node_ptr, env::env_ptr);
-obj::obj_ptr evalIndex(ast::node_ptr, ast::node_ptr, env::env_ptr);
-obj::obj_ptr evalIndexAssign(ast::index_ptr, ast::node_ptr, env::env_ptr);
+obj::obj_ptr evalBlock(const ast::block_ptr&, const env::env_ptr&);
+obj::Value evalIdent(const ast::ident_ptr&, const env::env_ptr&);
+obj::Value lookupIdent(symbol_id, const env::env_ptr&);
+obj::obj_ptr evalLet(const ast::let_ptr&, const env::env_ptr&);
+obj::Value evalIdentLet(const ast::let_ptr&, const env::env_ptr&);
+obj::obj_ptr evalOptLet(const ast::let_ptr&, const env::env_ptr&);
+// Initializes a new variable, in its slot if the Resolver gave it one
+void bindIdent(const ast::ident_ptr&, obj::Value, const env::env_ptr&);
+obj::int_ptr evalInteger(const ast::int_ptr&);
+obj::bool_ptr evalBool(const ast::bool_ptr&);
+obj::opt_ptr evalOption(const ast::opt_ptr&, const env::env_ptr&);
+obj::str_ptr evalString(const ast::str_ptr&);
+obj::arr_ptr evalList(const ast::arr_ptr&, const env::env_ptr&);
+obj::map_ptr evalMap(const ast::map_ptr&, const env::env_ptr&);
+void insertMapPair(obj::obj_map&, const obj::obj_ptr&, const obj::obj_ptr&);
+obj::func_ptr evalFunctionLiteral(const ast::func_ptr&, const env::env_ptr&);
+obj::obj_ptr evalInfix(const ast::infix_ptr&, const env::env_ptr&);
+obj::Value evalInfixValue(const ast::infix_ptr&, const env::env_ptr&);
+obj::obj_ptr evalInfixOperator(const Token&, const obj::obj_ptr&,
+                               const obj::obj_ptr&);
+obj::obj_ptr evalPrefix(const ast::prefix_ptr&, const env::env_ptr&);
+obj::obj_ptr evalPrefixOperator(const Token&, const obj::obj_ptr&);
+obj::Value evalAssign(const ast::ident_ptr&, const ast::node_ptr&,
+                      const env::env_ptr&);
+obj::obj_ptr evalIndex(const ast::node_ptr&, const ast::node_ptr&,
+                       const env::env_ptr&);
+obj::obj_ptr evalIndexOperator(const obj::obj_ptr&, const obj::obj_ptr&);
+obj::obj_ptr evalIndexAssign(const ast::index_ptr&, const ast::node_ptr&,
+                             const env::env_ptr&);
+obj::obj_ptr evalIndexAssignOperator(const obj::obj_ptr&, const obj::obj_ptr&,
+                                     const obj::obj_ptr&);
 
-obj::obj_ptr evalIntegerInfixOperator(Token, obj::int_ptr, obj::int_ptr);
-obj::obj_ptr evalBoolInfixOperator(Token, obj::bool_ptr, obj::bool_ptr);
-obj::obj_ptr evalStringInfixOperator(Token, obj::str_ptr, obj::str_ptr);
-obj::obj_ptr evalListInfixOperator(Token, obj::arr_ptr, obj::arr_ptr);
-obj::obj_ptr evalRangeInfixOperator(Token, obj::obj_ptr, obj::obj_ptr);
-obj::obj_ptr evalBangOperator(obj::obj_ptr);
-obj::obj_ptr evalMinusOperator(obj::int_ptr);
-obj::obj_ptr evalIfElse(ast::ifelse_ptr, env::env_ptr);
-obj::bool_ptr truthiness(obj::obj_ptr, bool = false);
+obj::obj_ptr evalIntegerInfixOperator(const Token&, const obj::int_ptr&,
+                                      const obj::int_ptr&);
+obj::Value evalIntegerInfixValue(const Token&, int64_t, int64_t);
+obj::obj_ptr evalBoolInfixOperator(const Token&, const obj::bool_ptr&,
+                                   const obj::bool_ptr&);
+obj::obj_ptr evalStringInfixOperator(const Token&, const obj::str_ptr&,
+                                     const obj::str_ptr&);
+obj::obj_ptr evalListInfixOperator(const Token&, const obj::arr_ptr&,
+                                   const obj::arr_ptr&);
+obj::obj_ptr evalRangeInfixOperator(const Token&, const obj::obj_ptr&,
+                                    const obj::obj_ptr&);
+obj::obj_ptr evalBangOperator(const obj::obj_ptr&);
+obj::obj_ptr evalMinusOperator(const obj::int_ptr&);
+obj::obj_ptr evalIfElse(const ast::ifelse_ptr&, const env::env_ptr&);
+obj::bool_ptr truthiness(const obj::obj_ptr&, bool = false);
+bool valueTruthiness(const obj::Value&);
+bool isError(const obj::Value&);
 obj::bool_ptr nativeBoolToObject(bool);
-obj::obj_list evalExpressionList(ast::node_list, env::env_ptr);
-obj::obj_ptr applyFunction(obj::obj_ptr, obj::obj_list);
-obj::obj_ptr unwrapReturn(obj::obj_ptr);
-obj::obj_ptr indexList(obj::arr_ptr, obj::obj_ptr, obj::obj_ptr = nullptr);
-obj::obj_ptr indexString(obj::str_ptr, obj::obj_ptr);
-obj::obj_ptr indexMap(obj::map_ptr, obj::obj_ptr, obj::obj_ptr = nullptr);
-obj::obj_ptr indexRange(obj::range_ptr, obj::obj_ptr);
+obj::obj_list evalExpressionList(const ast::node_list&, const env::env_ptr&);
+obj::obj_ptr applyFunction(const obj::obj_ptr&, obj::obj_list);
+// Same call, but numbers stay unboxed on their way into the function, and the
+// caller keeps the list, so it can be reused from one call to the next
+obj::obj_ptr applyFunction(const obj::obj_ptr&, const obj::value_list&);
+env::env_ptr callEnvironment(const obj::func_ptr&, size_t);
+obj::obj_ptr runFunction(const obj::func_ptr&, const env::env_ptr&);
+obj::obj_ptr unwrapReturn(const obj::obj_ptr&);
+obj::obj_ptr indexList(const obj::arr_ptr&, const obj::obj_ptr&,
+                       const obj::obj_ptr& = nullptr);
+obj::obj_ptr indexString(const obj::str_ptr&, const obj::obj_ptr&);
+obj::obj_ptr indexMap(const obj::map_ptr&, const obj::obj_ptr&,
+                      const obj::obj_ptr& = nullptr);
+obj::obj_ptr indexRange(const obj::range_ptr&, const obj::obj_ptr&);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,96 @@
+#ifndef INTERPRETER_H
+#define INTERPRETER_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "bytecode.h"
+#include "environment.h"
+#include "object.h"
+#include "value.h"
+
+class Program;
+typedef std::shared_ptr<const Program> program_ptr;
+
+// Values handed to a single run of a program, by variable name
+typedef std::unordered_map<std::string, obj::Value> bindings;
+
+/* Program:
+ * A script that's been lexed, parsed and resolved (and compiled, when it's
+ * meant for the VM) once, so it can be run any number of times without paying
+ * for any of that again. A program never changes once it's made, so the same
+ * one can be run by any number of interpreters, on any number of threads. */
+class Program {
+ public:
+  // Throws whatever the parser or compiler does
+  static program_ptr compile(std::string_view source, bool use_vm = false);
+
+  bool uses_vm() const { return proto != nullptr; }
+
+ private:
+  Program() {}
+
+  ast::block_ptr tree;
+  // Only set when compiled for the VM
+  vm::proto_ptr proto;
+
+  friend class Interpreter;
+};
+
+/* Interpreter:
+ * One running Parth program and everything it can change. Each interpreter has
+ * its own global environment, and every object its programs make is only
+ * reachable from there, so separate interpreters can run on separate threads
+ * without sharing anything they write to.
+ *
+ * What they do share is fixed before main() starts and never written again:
+ * the keyword, precedence and builtin tables, and the shared singletons (true,
+ * false, none, the small integers). The symbol table is shared as well, but
+ * each thread has its own cache in front of it (see symbol.h), and the object
+ * counts behind stats() are kept per thread (see alloc_stats.h).
+ *
+ * A single interpreter is not meant to be used from two threads at once. */
+class Interpreter {
+ public:
+  Interpreter();
+
+  // Lexes, parses and evaluates the source against this interpreter's
+  // globals. Variables a program declares are still there for the next one,
+  // the same way they would be in a REPL.
+  obj::obj_ptr run(std::string_view source);
+  obj::obj_ptr run(const program_ptr &program);
+
+  // Runs the program in a scope of its own, on top of the globals, with the
+  // bindings as its first variables. Whatever the program declares is cleared
+  // out of that scope once it's done, so every call starts from the same
+  // place, which is what a host running one script over many inputs wants.
+  //
+  // A function the program returns (on its own, or inside a list, map or
+  // option) can still be called afterwards, and sees everything the run
+  // declared, just as the program left it. Any function declared at the top
+  // of that run and the scope then hold each other, so they're never freed.
+  // Only what the result can reach is checked, so a function the program
+  // stashes somewhere else instead (in a global, say) loses the run's
+  // variables once the run is over.
+  obj::obj_ptr execute(const program_ptr &program, const bindings &inputs);
+
+  // Adds a global (or replaces one), to be seen by every program this
+  // interpreter runs from then on. Meant for what the host provides to all of
+  // them, like its own builtins.
+  void bind(const std::string &name, obj::Value value);
+
+  const env::env_ptr &globals() const { return envir; }
+
+ private:
+  env::env_ptr envir;
+  // Scopes from earlier calls to execute() that nothing held on to, emptied
+  // and kept so the next call can skip making one
+  std::vector<env::env_ptr> spare_scopes;
+
+  obj::obj_ptr run_in(const Program &program, const env::env_ptr &scope);
+};
+
+#endif
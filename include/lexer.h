@@ -3,17 +3,20 @@
 
 #include <iostream>
 #include <string>
+#include <string_view>
 #include "token.h"
 #include "util.h"
 
+// The lexer reads straight from the input without copying it, so the input
+// has to outlive the lexer, and number and string tokens (see token.h).
 class Lexer {
  public:
-  Lexer(const std::string &_input);
+  Lexer(std::string_view _input);
 
   Token next_token();
 
  private:
-  std::string input;
+  std::string_view input;
   uint position;
   uint read_position;
   char ch;
@@ -22,9 +25,9 @@ class Lexer {
   uint cur_column;
 
   void read_char();
-  std::string read_ident();
-  std::string read_num();
-  bool read_string(std::string &str);
+  std::string_view read_ident();
+  std::string_view read_num();
+  bool read_string(std::string_view &str);
   void skip_whitespace();
   char peak_char();
   void bump_line();
@@ -0,0 +1,75 @@
+#ifndef OBJ_MAP_H
+#define OBJ_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace obj {
+
+class Object;
+typedef std::shared_ptr<Object> obj_ptr;
+
+/* ObjMap:
+ * The hash table behind the Map object, laid out like CPython's compact dict.
+ * The pairs themselves live in a dense vector in the order they were first
+ * inserted, along with each key's hash. Next to it is a sparse index table
+ * that only holds positions into that vector, and is what gets probed on a
+ * lookup (linearly, from the key's home slot).
+ *
+ * That gives maps a stable order: printing, inspecting and iterating a map
+ * always go in insertion order, and iterating is a straight walk over
+ * contiguous memory. Inserting doesn't allocate short of growing, and the
+ * index stays small since its slots are only 4 bytes.
+ *
+ * Keys are matched by their hash first and then by obj::equals(), so two keys
+ * whose hashes collide are still kept apart.
+ *
+ * Maps can't have keys removed from them in Parth, so there's no erase (and
+ * no tombstones to skip). */
+class ObjMap {
+ public:
+  struct Entry {
+    obj_ptr key;
+    obj_ptr value;
+    uint64_t hash;
+  };
+
+  typedef std::vector<Entry>::const_iterator const_iterator;
+
+  ObjMap();
+
+  size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+  void reserve(size_t n);
+
+  // Gives back a pointer to the value for the key, or nullptr if it isn't in
+  // the map. The pointer is only good until the next insert.
+  const obj_ptr *find(const obj_ptr &key) const;
+  // Adds the pair at the end, or replaces the value in place if the key is
+  // already there
+  void insert(const obj_ptr &key, const obj_ptr &value);
+
+  // Entries by insertion order. Positions never change, so walking by
+  // position is safe even while the map is being added to.
+  const Entry &entry_at(size_t i) const { return entries[i]; }
+
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+
+ private:
+  std::vector<Entry> entries;
+  std::vector<uint32_t> index;
+
+  static constexpr uint32_t EMPTY = UINT32_MAX;
+  // The index is kept at most 2/3 full, as in CPython
+  static constexpr size_t MIN_INDEX_SIZE = 8;
+
+  size_t find_slot(const obj_ptr &key, uint64_t hash) const;
+  void rebuild_index(size_t size);
+};
+
+}  // namespace obj
+
+#endif
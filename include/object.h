@@ -2,12 +2,17 @@
 #define OBJECT_H
 
 #include <stdlib.h>
+#include <atomic>
 #include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 #include "SpookyV2.h"
+#include "alloc_stats.h"
 #include "ast.h"
+#include "obj_map.h"
+#include "pool.h"
 #include "util.h"
 
 // Need to forward declare environment
@@ -16,6 +21,13 @@ class Environment;
 typedef std::shared_ptr<Environment> env_ptr;
 }  // namespace env
 
+// Same goes for compiled function bodies, which are only attached to functions
+// created by the VM
+namespace vm {
+struct Proto;
+typedef std::shared_ptr<Proto> proto_ptr;
+}  // namespace vm
+
 namespace obj {
 
 enum obj_type {
@@ -62,16 +74,33 @@ typedef std::shared_ptr<ReturnVal> return_ptr;
 typedef std::shared_ptr<Error> err_ptr;
 
 typedef std::vector<obj_ptr> obj_list;
-// Might later look for a less convoluted way to represent the keys and values,
-// but currenty, accessing the key of an obj_map looks like:
-// => obj_map->second.first
-// While accessing the value looks like:
-// => obj_map->second.second
-// I know it's gross, I'll figure something out. Maybe it's own class...
 typedef std::pair<obj_ptr, obj_ptr> obj_pair;
-typedef std::unordered_map<uint64_t, obj_pair> obj_map;
+// Keys and values are reached through each entry, as in entry.key and
+// entry.value, see obj_map.h
+typedef ObjMap obj_map;
 // Forward declaration of builtin type for builtin object
-typedef obj::obj_ptr (*BI)(obj::obj_list);
+typedef obj::obj_ptr (*BI)(const obj::obj_list &);
+
+/* LazyHash:
+ * A hash that's only worked out the first time it's asked for. Objects can be
+ * shared between threads (see pmap), so the cache is atomic: two threads might
+ * both compute it at once, but they'll both get the same answer. Zero stands
+ * for "not yet", so a real hash of zero just never gets cached. */
+class LazyHash {
+ public:
+  template <typename F>
+  uint64_t get(F compute) {
+    uint64_t hash = cached.load(std::memory_order_relaxed);
+    if (hash == 0) {
+      hash = compute();
+      cached.store(hash, std::memory_order_relaxed);
+    }
+    return hash;
+  }
+
+ private:
+  std::atomic<uint64_t> cached{0};
+};
 
 class Object {
  public:
@@ -87,7 +116,10 @@ class Object {
   std::string wrap(std::string);
 };
 
-class Integer : public Object {
+// Integers and strings are created constantly as temporaries but rarely used
+// as map keys, so their hashes are only computed the first time they're asked
+// for, and cached from then on.
+class Integer : public Object, stats::Counted<INTEGER> {
  public:
   Integer(int64_t value);
   const int64_t value;
@@ -98,12 +130,30 @@ class Integer : public Object {
   obj_type _type();
 
  private:
-  uint64_t hash_cache;
+  LazyHash hash_cache;
 };
 
+// Integers from SMALL_INT_MIN to SMALL_INT_MAX are created once up front and
+// shared by everyone, much like the bool singletons. They're immutable, so
+// nobody can tell the difference, and loop counters, indices and most literals
+// stop allocating. Anything that makes an Integer should go through here.
+#ifndef SMALL_INT_MIN
+#define SMALL_INT_MIN -128
+#endif
+#ifndef SMALL_INT_MAX
+#define SMALL_INT_MAX 1024
+#endif
+
+int_ptr make_integer(int64_t value);
+
+// Structural equality, as used for map keys. It agrees with hash(): objects
+// that are equal always hash the same. Functions and builtins are only equal to
+// themselves.
+bool equals(const obj_ptr &left, const obj_ptr &right);
+
 // IMPORTANT! These should only be created once each for either bool value
 // to maintain two global singletons throughout evaluation.
-class Bool : public Object {
+class Bool : public Object, stats::Counted<BOOLEAN> {
  public:
   Bool(bool value);
   const bool value;
@@ -117,10 +167,26 @@ class Bool : public Object {
   uint64_t hash_cache;
 };
 
-class String : public Object {
+/* String:
+ * Strings are immutable, but building one up with + in a loop used to copy
+ * everything so far on every step. Instead, joining two strings makes a rope
+ * node that just points at both halves, and the text is only put together
+ * ("flattened") the first time someone needs it, in one pass. After that the
+ * node is a plain string and lets go of its halves.
+ *
+ * The length is always known without flattening. */
+class String : public Object, stats::Counted<STRING> {
  public:
   String(std::string value);
-  const std::string value;
+  ~String();
+
+  // Joins the two without copying either, unless the result is short
+  static str_ptr concat(const str_ptr &left, const str_ptr &right);
+
+  // The whole text, flattened first if it has to be. The reference stays good
+  // for as long as the string does.
+  const std::string &get_value();
+  size_t size() const { return length; }
 
   std::string print();
   std::string inspect();
@@ -128,63 +194,158 @@ class String : public Object {
   obj_type _type();
 
  private:
-  uint64_t hash_cache;
+  // Rope nodes are only made by concat(), through the pool
+  String(str_ptr left, str_ptr right);
+  template <typename>
+  friend class pool::Allocator;
+
+  // Copying a short result is cheaper than a node and a later flatten
+  static const size_t MIN_ROPE_LENGTH = 64;
+
+  std::string value;
+  // Only set on an unflattened rope node
+  str_ptr left;
+  str_ptr right;
+  size_t length;
+  // Set once value holds the whole text
+  std::atomic<bool> flat;
+  // Held while flattening, or while another rope's flatten() looks inside
+  std::atomic_flag flattening = ATOMIC_FLAG_INIT;
+  LazyHash hash_cache;
+
+  void flatten();
+  // Drops a rope node's halves, and any of theirs no one else holds, without
+  // recursing
+  static void let_go(str_ptr &left, str_ptr &right);
+};
+
+// Single-character strings are shared the same way small integers are. Every
+// possible byte gets one String, made the first time any of them is asked for,
+// so indexing into a string or walking it with each() doesn't allocate per
+// character, and each character's hash is only ever computed once.
+str_ptr make_char(char ch);
+
+/* HashCache:
+ * Lists and maps can be changed after they're made, and options can wrap
+ * them, so their hashes can't just be computed once like an integer's. Each
+ * list and map has a version that goes up whenever it's changed (see touch()),
+ * and the cached hash remembers the version it was computed at.
+ *
+ * That's only enough when the elements are plain values. If the object holds
+ * another list, map or option, the hash also depends on that one, so it's
+ * instead kept only as long as no list or map has changed since, which
+ * mutation_epoch() counts.
+ *
+ * Each thread keeps its own count, and a hash cached on one thread is never
+ * trusted on another, so threads never contend over it. A thread only counts
+ * its own changes, though, so wherever objects are handed over from another
+ * thread that might have changed them (pmap, or a host running interpreters
+ * on several threads) the receiving thread calls forget_nested_hashes(). */
+struct HashCache {
+  uint64_t value = 0;
+  uint64_t version = 0;
+  uint64_t epoch = 0;
+  bool nested = false;
+  // Held while reading or storing, since pmap can hash the same list from
+  // several threads
+  std::atomic_flag busy = ATOMIC_FLAG_INIT;
+
+  // Gives back the cached hash if it's still good for this version
+  bool lookup(uint64_t cur_version, uint64_t &hash);
+  void store(uint64_t hash, uint64_t cur_version, bool nested);
 };
 
-class Option : public Object {
+// Goes up whenever this thread changes a list or map
+uint64_t mutation_epoch();
+// Stops this thread trusting any nested hash it has cached, for when another
+// thread may have changed something
+void forget_nested_hashes();
+
+// Whether an object's hash can change after it's made
+bool is_container(const obj_ptr &);
+
+class Option : public Object, stats::Counted<OPTION> {
  public:
   Option();
   Option(obj_ptr);
-  obj_ptr value;
+  const obj_ptr value;
 
   std::string print();
   std::string inspect();
   uint64_t hash();
   obj_type _type();
+
+ private:
+  HashCache hash_cache;
 };
 
-class List : public Object {
+class List : public Object, stats::Counted<LIST> {
  public:
   List(obj_list values);
+  // Anything that changes the values has to call touch() afterwards
   obj_list values;
 
+  void touch();
+
   std::string print();
   std::string inspect();
   uint64_t hash();
   obj_type _type();
+
+ private:
+  uint64_t version;
+  HashCache hash_cache;
 };
 
-class Map : public Object {
+class Map : public Object, stats::Counted<MAP> {
  public:
-  Map(obj_map pairs);
+  Map(obj_map &&pairs);
+  // Anything that changes the pairs has to call touch() afterwards
   obj_map pairs;
 
+  void touch();
+
   std::string print();
   std::string inspect();
   uint64_t hash();
   obj_type _type();
+
+ private:
+  uint64_t version;
+  HashCache hash_cache;
 };
 
-class Range : public Object {
+// The bounds are plain numbers, so making a range, measuring it, indexing it
+// and hashing it never needs an Integer object. Both ends are inclusive.
+class Range : public Object, stats::Counted<RANGE> {
  public:
-  Range(int_ptr start, int_ptr end);
-  const int_ptr start;
-  const int_ptr end;
+  Range(int64_t start, int64_t end);
+  const int64_t start;
+  const int64_t end;
 
   bool forward();
   bool between(int64_t);
+  // How many integers are in the range
+  uint64_t size();
 
   std::string print();
   std::string inspect();
   uint64_t hash();
   obj_type _type();
+
+ private:
+  LazyHash hash_cache;
 };
 
-class Function : public Object {
+class Function : public Object, stats::Counted<FUNCTION> {
  public:
   Function(ast::func_ptr func_node, env::env_ptr envir);
+  Function(ast::func_ptr func_node, env::env_ptr envir, vm::proto_ptr proto);
   ast::func_ptr func_node;
   env::env_ptr envir;
+  // Bytecode for the body when the function was created by the VM, otherwise
+  // null and the body is walked by eval()
+  vm::proto_ptr proto;
 
   std::string print();
   std::string inspect();
@@ -195,10 +356,13 @@ class Function : public Object {
   uint64_t hash_cache;
 };
 
-class Builtin : public Object {
+class Builtin : public Object, stats::Counted<BUILTIN> {
  public:
-  Builtin(BI);
+  // The name is what the builtin was looked up by, or empty for ones the host
+  // made. It has to outlive the object, which interned names always do.
+  Builtin(BI, std::string_view name = std::string_view());
   BI fn;
+  std::string_view name;
 
   std::string print();
   std::string inspect();
@@ -206,7 +370,7 @@ class Builtin : public Object {
   obj_type _type();
 };
 
-class ReturnVal : public Object {
+class ReturnVal : public Object, stats::Counted<RETURN_VAL> {
  public:
   ReturnVal(obj_ptr o);
   obj_ptr value;
@@ -217,7 +381,7 @@ class ReturnVal : public Object {
   obj_type _type();
 };
 
-class Error : public Object {
+class Error : public Object, stats::Counted<ERROR> {
  public:
   Error(std::string err);
   std::string err;
@@ -8,8 +8,10 @@
 #include <sstream>
 #include <string>
 #include <unordered_map>
+#include "arena.h"
 #include "ast.h"
 #include "lexer.h"
+#include "resolver.h"
 #include "token.h"
 #include "token_type.h"
 #include "util.h"
@@ -38,6 +40,7 @@ class Parser {
   ast::block_ptr parse_program();
   ast::node_ptr parse_line();
   error_list get_all_errors();
+  ast::arena_ptr get_arena();
 
   Token get_cur_token();
   Token get_peek_token();
@@ -53,6 +56,13 @@ class Parser {
   void ignore_newlines();
   Token after_paren();
 
+  // Nodes are all allocated in the parser's arena (see arena.h)
+  template <typename T, typename... Args>
+  std::shared_ptr<T> make_node(Args &&... args) {
+    return std::allocate_shared<T>(ast::ArenaAllocator<T>(arena),
+                                   std::forward<Args>(args)...);
+  }
+
   enum rank {
     LOWEST,   // For restarting a precedence scope inside brackets
     ASSIGN,   // =
@@ -74,6 +84,7 @@ class Parser {
 
  private:
   Lexer *lexer;
+  ast::arena_ptr arena;
   error_list errors;
 
   // Parsing functions
@@ -90,7 +101,7 @@ class Parser {
   Token pop_queued_token();
 
   // Token Presedence
-  static rank_map precedences;
+  static const rank_map precedences;
 };
 
 // Prefix parsing functions
@@ -120,23 +131,42 @@ ast::block_ptr parse_block(Parser &p);
 ast::node_list parse_expression_list(Parser &p, TokenType end_token);
 ast::kv_pair parse_expression_pair(Parser &p);
 
-// Errors
+// Errors. Like the ones in parth_error.h, each puts its message together when
+// it's thrown and never prints anything itself.
 class UnexpectedException : public std::exception {
  public:
   explicit UnexpectedException(const TokenType &expected, const Token &got)
-      : expected(expected), got(got){};
+      : expected(expected),
+        got(got),
+        // Copied, since a number or string token points into the source,
+        // which might be gone by the time this is caught
+        message("Unexpected token \"" + got.get_literal() + "\" at line " +
+                std::to_string(got.get_line()) + ", col " +
+                std::to_string(got.get_column()) + "; Expected " +
+                token_type_string(expected)) {}
 
   TokenType expected;
   Token got;
+  std::string message;
 
-  virtual const char *what() const throw() {
-    std::ostringstream oss;
-    oss << "Unexpected token \"" << got.get_literal() << "\" at line "
-        << got.get_line() << ", col " << got.get_column() << "; Expected "
-        << token_type_string(expected) << std::endl;
-    std::cout << oss.str();
-    return "";
-  }
+  virtual const char *what() const throw() { return message.c_str(); }
+};
+
+// For a token that can't start an expression, like a stray `)`
+class NoPrefixException : public std::exception {
+ public:
+  explicit NoPrefixException(const Token &got)
+      : got(got),
+        message("Can't start an expression with " +
+                token_type_string(got.get_type()) + " \"" +
+                got.get_literal() + "\" at line " +
+                std::to_string(got.get_line()) + ", col " +
+                std::to_string(got.get_column())) {}
+
+  Token got;
+  std::string message;
+
+  virtual const char *what() const throw() { return message.c_str(); }
 };
 
 #endif
\ No newline at end of file
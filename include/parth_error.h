@@ -1,38 +1,34 @@
 #ifndef ERROR_H
 #define ERROR_H
 
+// Every error puts its message together when it's thrown, so what() only hands
+// back a string the exception owns. Nothing here prints; that's up to whoever
+// catches it.
+
 #include <exception>
-#include <iostream>
-#include <sstream>
 #include <string>
 #include "token.h"
 
 class InitVarException : public std::exception {
  public:
-  explicit InitVarException(const std::string &var) : var(var){};
+  explicit InitVarException(const std::string &var)
+      : var(var), message("Variable " + var + " already exists in top scope") {}
 
   std::string var;
+  std::string message;
 
-  virtual const char *what() const throw() {
-    std::ostringstream oss;
-    oss << "Variable " << var << " already exists in top scope\n";
-    return oss.str().c_str();
-  }
+  virtual const char *what() const throw() { return message.c_str(); }
 };
 
 class NoVarException : public std::exception {
  public:
-  explicit NoVarException(const std::string &var) : var(var){};
+  explicit NoVarException(const std::string &var)
+      : var(var), message("Variable " + var + " does not exist") {}
 
   std::string var;
+  std::string message;
 
-  virtual const char *what() const throw() {
-    std::ostringstream oss;
-    oss << "Variable " << var << " does not exist\n";
-    std::string str = std::string(oss.str());
-    std::cout << str;
-    return "";
-  }
+  virtual const char *what() const throw() { return message.c_str(); }
 };
 
 class NoSuchOperatorException : public std::exception {
@@ -47,16 +43,16 @@ class NoSuchOperatorException : public std::exception {
 
 class DivideByZeroException : public std::exception {
  public:
-  explicit DivideByZeroException(const Token &location) : location(location){};
+  explicit DivideByZeroException(const Token &location)
+      : location(location),
+        message("Divide by Zero at line " +
+                std::to_string(location.get_line()) + ", col " +
+                std::to_string(location.get_column())) {}
 
   Token location;
+  std::string message;
 
-  virtual const char *what() const throw() {
-    std::ostringstream oss;
-    oss << "Divide by Zero at line " << location.get_line() << ", col "
-        << location.get_column();
-    return oss.str().c_str();
-  }
+  virtual const char *what() const throw() { return message.c_str(); }
 };
 
 class InvalidArgsException : public std::exception {
@@ -78,4 +74,23 @@ class InvalidKeyException : public std::exception {
   virtual const char *what() const throw() { return message.c_str(); }
 };
 
+class CompileException : public std::exception {
+ public:
+  explicit CompileException(const std::string &message) : message(message) {}
+
+  std::string message;
+
+  virtual const char *what() const throw() { return message.c_str(); }
+};
+
+class SourceException : public std::exception {
+ public:
+  SourceException(const std::string &path, const std::string &reason)
+      : message("Could not load " + path + ": " + reason) {}
+
+  std::string message;
+
+  virtual const char *what() const throw() { return message.c_str(); }
+};
+
 #endif
\ No newline at end of file
@@ -0,0 +1,94 @@
+#ifndef POOL_H
+#define POOL_H
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <utility>
+
+namespace pool {
+
+/* Pool:
+ * Objects and environments come and go constantly (every call makes an
+ * environment, most arithmetic makes an integer that's gone by the next
+ * statement), so instead of going back to malloc each time, freed blocks are
+ * kept on a free list and handed out again to the next thing of that size.
+ *
+ * Blocks are sorted by size, rounded up to the next SIZE_STEP, rather than by
+ * type, so things the same size share a list. Every thread keeps its own lists
+ * and never locks. A block freed on another thread than the one that made it
+ * (as pmap results are) simply joins the freeing thread's list. Each list
+ * holds at most MAX_FREE blocks, and anything past that goes back to malloc,
+ * as does everything left on a thread's lists once the thread ends. */
+
+const size_t SIZE_STEP = 16;
+// Bigger blocks aren't pooled
+const size_t MAX_SIZE = 256;
+const size_t MAX_FREE = 4096;
+
+// A block of at least size bytes, aligned for anything
+void *take(size_t size);
+// Gives back a block from take() of the same size
+void give(void *block, size_t size);
+// How many blocks of that size this thread has waiting to be reused
+size_t free_count(size_t size);
+
+/* Allocator:
+ * Lets std::allocate_shared put an object (and its refcount, in the same
+ * block) in the pool. It has no state, so any two of them are interchangeable.
+ * Classes with private constructors can befriend it to still be made. */
+template <typename T>
+class Allocator {
+ public:
+  typedef T value_type;
+
+  Allocator() {}
+  template <typename U>
+  Allocator(const Allocator<U> &) {}
+
+  T *allocate(size_t n) {
+    if (n != 1 || sizeof(T) > MAX_SIZE) {
+      return static_cast<T *>(::operator new(n * sizeof(T)));
+    }
+    static_assert(alignof(T) <= alignof(std::max_align_t),
+                  "Pooled blocks are only aligned for the fundamental types");
+    return static_cast<T *>(take(sizeof(T)));
+  }
+  void deallocate(T *ptr, size_t n) {
+    if (n != 1 || sizeof(T) > MAX_SIZE) {
+      ::operator delete(ptr);
+    } else {
+      give(ptr, sizeof(T));
+    }
+  }
+
+  template <typename U, typename... Args>
+  void construct(U *ptr, Args &&... args) {
+    ::new (static_cast<void *>(ptr)) U(std::forward<Args>(args)...);
+  }
+  template <typename U>
+  void destroy(U *ptr) {
+    ptr->~U();
+  }
+};
+
+template <typename T, typename U>
+bool operator==(const Allocator<T> &, const Allocator<U> &) {
+  return true;
+}
+
+template <typename T, typename U>
+bool operator!=(const Allocator<T> &, const Allocator<U> &) {
+  return false;
+}
+
+// How every object and environment is made, so each one is a single
+// allocation that's likely to be recycled
+template <typename T, typename... Args>
+std::shared_ptr<T> make(Args &&... args) {
+  return std::allocate_shared<T>(Allocator<T>(), std::forward<Args>(args)...);
+}
+
+}  // namespace pool
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+#include <ostream>
+#include "ast.h"
+#include "object.h"
+
+/* Profiling:
+ * Counts and times what eval() spends its time on: every node it evaluates, by
+ * node type, and every call, by function (named by where it was written) or
+ * builtin (named by what it was called as). Calls are also kept by the stack
+ * they were made from, so the time can be drawn as a flame graph.
+ *
+ * It's only built in with `make PROFILE=1`, which defines PARTH_PROFILE.
+ * Otherwise the hooks below expand to nothing, so the evaluator is exactly
+ * what it would be without them.
+ *
+ * Each thread records into its own profile (pmap() workers included), and the
+ * reports add them all up. Reporting and resetting are meant for when nothing
+ * is being evaluated. */
+
+namespace prof {
+
+#ifdef PARTH_PROFILE
+constexpr bool ENABLED = true;
+#else
+constexpr bool ENABLED = false;
+#endif
+
+// Node types by self time, then functions and builtins by self time with
+// their call counts and total (inclusive) time
+void report_flat(std::ostream &out);
+// One line per distinct stack, "main;fn@3:11;len 5200", with the self time in
+// nanoseconds, which is what flamegraph.pl takes
+void report_collapsed(std::ostream &out);
+// Throws away everything recorded so far
+void reset();
+
+#ifdef PARTH_PROFILE
+
+struct ThreadProfile;
+
+// Times one node, minus the nodes under it
+class NodeTimer {
+ public:
+  explicit NodeTimer(ast::node_type type);
+  ~NodeTimer();
+
+ private:
+  ThreadProfile &profile;
+  ast::node_type type;
+  uint64_t start;
+};
+
+// Times one call, as a frame on the current stack
+class CallTimer {
+ public:
+  explicit CallTimer(const ast::Function &func);
+  explicit CallTimer(const obj::Builtin &builtin);
+  ~CallTimer();
+
+ private:
+  ThreadProfile &profile;
+  uint64_t start;
+
+  void enter(uint32_t frame);
+};
+
+#define PROFILE_NODE(type) prof::NodeTimer prof_node_timer_(type)
+#define PROFILE_CALL(callee) prof::CallTimer prof_call_timer_(callee)
+
+#else
+
+#define PROFILE_NODE(type)
+#define PROFILE_CALL(callee)
+
+#endif
+
+}  // namespace prof
+
+#endif
@@ -0,0 +1,46 @@
+#ifndef RESOLVER_H
+#define RESOLVER_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "ast.h"
+#include "symbol.h"
+
+/* The resolver is a pass over a parsed program that works out, ahead of time,
+ * where every variable lives. Each scope (the program and every function
+ * body) gets its variables laid out in numbered slots, and each identifier is
+ * given the (depth, slot) of the variable it refers to, so that environments
+ * can be plain vectors and variable access never has to hash a name.
+ *
+ * Within a scope, a name is only visible after the `let` that declares it,
+ * just like it would be at runtime (so `let x = x + 1` still sees an outer x).
+ * Function bodies only run once they're called, so they are resolved after
+ * the rest of their enclosing scope, and they can see everything it declares,
+ * which is what lets functions call themselves or each other. If one gets
+ * called before its scope reaches the `let` of a name it uses, it sees that
+ * name further out instead (or the global), as it would if it went by name.
+ *
+ * Globals (the variables the program itself declares) are left unresolved and
+ * stay looked up by name. The same environment can be handed to several
+ * programs in a row, or filled in by whoever is running the program, so their
+ * layout can't be known from a single program. Builtins are also left
+ * unresolved, since they win over variables of the same name. */
+class Resolver {
+ public:
+  void resolve_program(ast::block_ptr program);
+
+ private:
+  struct Scope {
+    std::unordered_map<symbol_id, int> slots;
+    std::vector<ast::func_ptr> deferred;
+  };
+  std::vector<Scope> scopes;
+
+  void resolve_scope(ast::block_ptr body, const ast::param_list *params);
+  void resolve(ast::node_ptr node);
+  void resolve_ident(ast::ident_ptr ident);
+  void declare(ast::ident_ptr ident);
+};
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef SAMPLER_H
+#define SAMPLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "ast.h"
+#include "object.h"
+
+/* Sampler:
+ * A sampling profiler for Parth code. While it runs, a SIGPROF timer goes off
+ * every so often (in CPU time) and the signal handler copies the Parth call
+ * stack of whichever thread was running: which functions and builtins were
+ * being called, and what line each of them was on. Counting how often each
+ * stack shows up gives the hot spots, without timing every node the way the
+ * PROFILE=1 build does (see profile.h).
+ *
+ * The stack it copies is a small one that eval() and the VM keep up to date as
+ * they go, one frame per call and a line number per statement (the VM has an
+ * OP_LINE at the start of each one). That's cheap enough to
+ * always be on, so a production build can be sampled as is.
+ *
+ * The handler doesn't allocate or lock. Samples go into a buffer made by
+ * start(), with their frames in a pool they share, and once either is full,
+ * later samples are just counted as dropped. */
+
+namespace sample {
+
+// One call on the stack. A function is kept as where it was written rather
+// than as its node, so a sample still makes sense once the tree is gone. The
+// bottom frame (the program itself) has neither a builtin nor a function.
+struct Frame {
+  // An interned name, so it's null-terminated and never goes away
+  const char *builtin;
+  uint32_t func_line;
+  uint32_t func_column;
+  // The statement the call is on, 0 for builtins
+  uint32_t line;
+};
+
+// What eval() and the VM keep up to date. Every thread has its own.
+class CallStack {
+ public:
+  static constexpr size_t MAX_DEPTH = 256;
+
+  void push(const char *builtin, uint32_t func_line, uint32_t func_column) {
+    uint32_t at = depth.load(std::memory_order_relaxed);
+    if (at < MAX_DEPTH) {
+      frames[at] = Frame{builtin, func_line, func_column, func_line};
+    }
+    // The frame has to be filled in before the handler can see it
+    std::atomic_signal_fence(std::memory_order_release);
+    depth.store(at + 1, std::memory_order_relaxed);
+  }
+  void pop() {
+    depth.store(depth.load(std::memory_order_relaxed) - 1,
+                std::memory_order_relaxed);
+  }
+  void at_line(uint32_t line) {
+    uint32_t at = depth.load(std::memory_order_relaxed);
+    if (at <= MAX_DEPTH) {
+      frames[at - 1].line = line;
+    }
+  }
+
+  // Frames past MAX_DEPTH are counted but not kept
+  Frame frames[MAX_DEPTH];
+  // Starts at 1, for the program's own frame
+  std::atomic<uint32_t> depth{1};
+};
+
+// Only ever made once per thread, and with nothing to run on the way, so the
+// signal handler can reach it safely
+inline CallStack &call_stack() {
+  static thread_local CallStack stack;
+  return stack;
+}
+
+// Keeps a call on the stack for as long as it's running, exceptions included
+class FrameGuard {
+ public:
+  explicit FrameGuard(const ast::Function &func) : stack(call_stack()) {
+    stack.push(nullptr, func.token.get_line(), func.token.get_column());
+  }
+  explicit FrameGuard(const obj::Builtin &builtin) : stack(call_stack()) {
+    stack.push(builtin.name.empty() ? "builtin" : builtin.name.data(), 0, 0);
+  }
+  ~FrameGuard() { stack.pop(); }
+
+ private:
+  CallStack &stack;
+};
+
+// Starts sampling every thread's CPU time, at the given rate, keeping at most
+// `capacity` samples. There's room for 16 frames a sample on average, so the
+// default comes to about 8MB. Throws std::runtime_error if the timer can't be
+// set, or if the sampler is already running.
+void start(int hz = 100, size_t capacity = 20000);
+// Stops the timer. The samples stay until the next start().
+void stop();
+bool running();
+
+size_t sample_count();
+// Samples that came in after the buffer was full
+size_t dropped();
+
+// One line per distinct stack, "main:7;fn@1:10:3;len 42", each frame named
+// the way the PROFILE=1 build names it and followed by the line it was on,
+// then how many samples had that stack. That's the folded format
+// flamegraph.pl and speedscope read. Stacks deeper than a sample keeps start
+// with "..." instead of main.
+void write_folded(std::ostream &out);
+
+}  // namespace sample
+
+#endif
@@ -0,0 +1,32 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+/* SourceFile:
+ * A script mapped read-only into memory. The lexer reads straight out of the
+ * mapping, so loading a script never copies it into a std::string. Since
+ * the tree doesn't point into its source (see token.h), the file only has to
+ * stay mapped until parsing is done.
+ *
+ * Throws a SourceException if the file can't be opened or mapped. */
+class SourceFile {
+ public:
+  explicit SourceFile(const std::string &path);
+  ~SourceFile();
+
+  SourceFile(const SourceFile &) = delete;
+  SourceFile &operator=(const SourceFile &) = delete;
+
+  std::string_view text() const { return std::string_view(data, size); }
+  const std::string &get_path() const { return path; }
+
+ private:
+  std::string path;
+  const char *data;
+  size_t size;
+};
+
+#endif
@@ -0,0 +1,41 @@
+#ifndef SYMBOL_H
+#define SYMBOL_H
+
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+typedef uint32_t symbol_id;
+
+/* SymbolTable:
+ * Every identifier is interned here once, and gets a small integer ID. Later
+ * stages compare and hash those IDs instead of strings. Literals aren't
+ * interned, since nothing looks them up by name and the table only grows.
+ *
+ * Interned text is never freed or moved, so a string_view to it stays valid for
+ * the life of the program. That's what lets name tokens point at their text
+ * without owning a copy, and without having to keep the source around. The table is
+ * shared by every thread and guarded by a lock, but each thread keeps its own
+ * cache in front of it, so interpreters on separate threads only meet there
+ * for names none of them has seen yet. */
+class SymbolTable {
+ public:
+  static symbol_id intern(std::string_view text);
+  static std::string_view name(symbol_id id);
+
+ private:
+  struct Table {
+    std::mutex lock;
+    // A deque never moves what it already holds
+    std::deque<std::string> names;
+    std::unordered_map<std::string_view, symbol_id> ids;
+  };
+
+  // Built on first use, so interning works during static initialization too
+  static Table &table();
+};
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* ThreadPool:
+ * A fixed set of worker threads for spreading a loop across cores. Each worker
+ * has its own queue of tasks and works from the back of it, and once it runs
+ * dry it steals from the front of someone else's, so a worker that got the
+ * cheap end of a loop doesn't sit idle while another is still busy.
+ *
+ * The thread that calls parallel_for() works on the loop too instead of just
+ * waiting, which also means a task can start a parallel_for() of its own
+ * without tying up the pool. */
+class ThreadPool {
+ public:
+  explicit ThreadPool(size_t thread_count);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // One worker per core, made the first time it's asked for
+  static ThreadPool &shared();
+
+  // Calls body(begin, end) over every chunk of [0, count), each chunk at most
+  // grain long, and returns once they've all run. If any chunk throws, the
+  // first exception is rethrown here (once the rest have finished).
+  void parallel_for(size_t count, size_t grain,
+                    const std::function<void(size_t, size_t)> &body);
+
+  size_t size() const { return workers.size(); }
+
+ private:
+  typedef std::function<void()> Task;
+
+  struct Worker {
+    std::mutex lock;
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  std::vector<std::unique_ptr<Worker>> workers;
+  // Where the next task goes, so a loop's chunks get spread around
+  std::atomic<size_t> next_worker;
+
+  // Sleeping workers wait here until there's something queued
+  std::mutex sleep_lock;
+  std::condition_variable wake;
+  std::atomic<size_t> queued;
+  bool stopping;
+
+  void push(Task task);
+  bool pop(size_t home, Task &task);
+  void work(size_t id);
+};
+
+#endif
@@ -3,32 +3,56 @@
 #define TOKEN_H
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include "symbol.h"
 #include "token_type.h"
 
-typedef std::unordered_map<std::string, TokenType> keyword_map;
+typedef std::unordered_map<std::string_view, TokenType> keyword_map;
 
 // Tokens are immutable, set once and forget.
+//
+// A token doesn't own its literal, so tokens are cheap to copy. Names are
+// interned in the SymbolTable, and operators and keywords are fixed strings
+// that live for the whole program, so those tokens can outlive their source.
+// Number and string literals aren't interned (a script full of them would
+// grow the table forever), so their tokens point into the source and only
+// last as long as it does. The parser copies that text into the nodes it
+// makes, so the tree never points into the source.
 class Token {
  private:
   TokenType type;
-  std::string literal;
+  std::string_view literal;
+  symbol_id symbol;
   uint column;
   uint line;
 
-  static keyword_map keywords;
+  static const keyword_map keywords;
 
  public:
+  static constexpr symbol_id NO_SYMBOL = UINT32_MAX;
+
   Token();
-  Token(TokenType _type, std::string _literal, uint _column, uint _line);
+  // Interns the literal, so it can come from anywhere
+  Token(TokenType _type, std::string_view _literal, uint _column, uint _line);
+
+  // Keeps the literal as given, for text that outlives the token some other
+  // way: string constants, the source, or the node the token ends up in
+  static Token fixed(TokenType _type, std::string_view _literal, uint _column,
+                     uint _line);
 
   TokenType get_type() const;
   std::string get_literal() const;
+  std::string_view literal_view() const;
+  // The interned ID of the literal, or NO_SYMBOL for fixed tokens
+  symbol_id get_symbol() const;
   uint get_column() const;
   uint get_line() const;
   bool is_empty() const;
 
-  static TokenType lookup_ident(std::string &ident);
+  // Gives back the keyword's own (fixed) text as well, if it is one
+  static TokenType lookup_ident(std::string_view ident,
+                                std::string_view *keyword = nullptr);
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -1,9 +1,21 @@
 #ifndef PARTH_UTIL_H
 #define PARTH_UTIL_H
 
+#include <cassert>
 #include <iostream>
+#include <memory>
 
 // For quick debugging-via-prints;
 void bust(std::string str);
 
+// Downcasts a pointer whose type is already known, usually because we just
+// switched on its _type(). Going through dynamic_pointer_cast there only pays
+// for RTTI to tell us what we already know. Debug builds still check that the
+// cast is valid, but with NDEBUG (make RELEASE=1) it's a plain static cast.
+template <typename T, typename U>
+std::shared_ptr<T> fast_cast(const std::shared_ptr<U> &ptr) {
+  assert(ptr == nullptr || std::dynamic_pointer_cast<T>(ptr) != nullptr);
+  return std::static_pointer_cast<T>(ptr);
+}
+
 #endif
\ No newline at end of file
@@ -0,0 +1,59 @@
+#ifndef VALUE_H
+#define VALUE_H
+
+#include <memory>
+#include <vector>
+#include "object.h"
+
+namespace obj {
+
+/* Value:
+ * A tagged value that keeps integers, bools and none inline, and only points
+ * at a heap object for everything else (strings, lists, maps, functions...).
+ * This is what the VM keeps on its stack and what environments store, so that
+ * arithmetic and comparisons never have to allocate an object just to hold a
+ * temporary number.
+ *
+ * A Value made from an existing object holds on to it, so boxing it back gives
+ * the very same object (identity matters for lists and maps). A Value made
+ * from a raw number has no object until it's boxed, which allocates. */
+class Value {
+ public:
+  // An empty value stands in for a null obj_ptr
+  Value();
+  Value(obj_ptr object);
+  // Lets the typed pointers (int_ptr, opt_ptr...) convert just as easily
+  template <typename T>
+  Value(std::shared_ptr<T> object) : Value(obj_ptr(object)) {}
+
+  static Value integer(int64_t num);
+  static Value boolean(bool b);
+  static Value none();
+
+  bool is_empty() const { return kind == EMPTY; }
+  bool is_int() const { return kind == INT; }
+  bool is_bool() const { return kind == BOOL; }
+  bool is_none() const { return kind == NONE; }
+  bool is_object() const { return kind == OBJECT; }
+
+  int64_t as_int() const { return num; }
+  bool as_bool() const { return num != 0; }
+  const obj_ptr &object() const { return ref; }
+
+  obj_type type() const;
+  // The value as a heap object, allocating an Integer if the number has none
+  obj_ptr box() const;
+
+ private:
+  enum value_kind : uint8_t { EMPTY, INT, BOOL, NONE, OBJECT };
+
+  value_kind kind;
+  int64_t num;
+  obj_ptr ref;
+};
+
+typedef std::vector<Value> value_list;
+
+}  // namespace obj
+
+#endif
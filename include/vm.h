@@ -0,0 +1,22 @@
+#ifndef VM_H
+#define VM_H
+
+#include <memory>
+#include "ast.h"
+#include "bytecode.h"
+#include "environment.h"
+#include "object.h"
+
+namespace vm {
+
+// Compiles the program and runs it in the given environment. Gives back the
+// same value eval() would for the same program.
+obj::obj_ptr run(ast::block_ptr program, env::env_ptr envir);
+
+// Runs an already compiled proto. Function bodies are run through here by
+// applyFunction once their arguments are bound in the new environment.
+obj::obj_ptr execute(const Proto &proto, env::env_ptr envir);
+
+}  // namespace vm
+
+#endif
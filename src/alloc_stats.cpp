@@ -0,0 +1,171 @@
+#include "alloc_stats.h"
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include "environment.h"
+#include "object.h"
+
+namespace {
+
+// What each kind is called, and how big one of it is, in kind order
+struct Kind {
+  const char *name;
+  size_t size;
+};
+
+const Kind KINDS[] = {
+    {"INTEGER", sizeof(obj::Integer)},
+    {"BOOLEAN", sizeof(obj::Bool)},
+    {"STRING", sizeof(obj::String)},
+    {"LIST", sizeof(obj::List)},
+    {"MAP", sizeof(obj::Map)},
+    {"RANGE", sizeof(obj::Range)},
+    {"OPTION", sizeof(obj::Option)},
+    {"FUNCTION", sizeof(obj::Function)},
+    {"BUILTIN", sizeof(obj::Builtin)},
+    {"RETURN_VAL", sizeof(obj::ReturnVal)},
+    {"ERROR", sizeof(obj::Error)},
+    {"ENVIRONMENT", sizeof(env::Environment)},
+};
+
+static_assert(sizeof(KINDS) / sizeof(Kind) == env::ENV_KIND + 1,
+              "Every kind that's counted needs a name");
+static_assert(env::ENV_KIND < stats::MAX_KINDS, "Too many kinds to count");
+
+// What every thread that's finished had counted
+struct Totals {
+  uint64_t new_allocs;
+  uint64_t new_frees;
+  uint64_t new_bytes;
+  uint64_t allocs[stats::MAX_KINDS];
+  uint64_t frees[stats::MAX_KINDS];
+  uint64_t peak[stats::MAX_KINDS];
+
+  void add(const stats::ThreadCounts &counts) {
+    new_allocs += counts.new_allocs.load(std::memory_order_relaxed);
+    new_frees += counts.new_frees.load(std::memory_order_relaxed);
+    new_bytes += counts.new_bytes.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < stats::MAX_KINDS; i++) {
+      allocs[i] += counts.allocs[i].load(std::memory_order_relaxed);
+      frees[i] += counts.frees[i].load(std::memory_order_relaxed);
+      int64_t most = counts.peak[i].load(std::memory_order_relaxed);
+      peak[i] += most > 0 ? most : 0;
+    }
+  }
+};
+
+// Every thread that's counted anything and is still running, linked through
+// their counts. The lock is only taken when a thread starts or finishes
+// counting, and when the counts are read, never to count. Both are plain data,
+// so they're ready before any thread could enlist.
+std::mutex enlisted_lock;
+stats::ThreadCounts *enlisted = nullptr;
+Totals finished;
+
+// Hands a thread's counts over to `finished` when it ends. Anything it frees
+// after that (like its pooled blocks, see pool.cpp) isn't counted.
+struct Retire {
+  stats::ThreadCounts *counts;
+
+  ~Retire() {
+    std::lock_guard<std::mutex> guard(enlisted_lock);
+    finished.add(*counts);
+    stats::ThreadCounts **link = &enlisted;
+    while (*link != counts) {
+      link = &(*link)->next;
+    }
+    *link = counts->next;
+  }
+};
+
+// Every thread's counts so far
+Totals total() {
+  Totals sum = finished;
+  for (stats::ThreadCounts *counts = enlisted; counts != nullptr;
+       counts = counts->next) {
+    sum.add(*counts);
+  }
+  return sum;
+}
+
+}  // namespace
+
+void stats::enlist(ThreadCounts &counts) {
+  counts.enlisted = true;
+  {
+    std::lock_guard<std::mutex> guard(enlisted_lock);
+    counts.next = enlisted;
+    enlisted = &counts;
+  }
+  thread_local Retire retire{&counts};
+}
+
+/*************/
+/*** STATS ***/
+/*************/
+
+stats::Allocations stats::allocations() {
+  std::lock_guard<std::mutex> guard(enlisted_lock);
+  Totals sum = total();
+  return Allocations{sum.new_allocs, sum.new_frees, sum.new_bytes};
+}
+
+stats::Allocations stats::Allocations::operator-(
+    const Allocations &other) const {
+  return Allocations{allocs - other.allocs, frees - other.frees,
+                     bytes - other.bytes};
+}
+
+std::string stats::Allocations::to_string() const {
+  std::ostringstream oss;
+  oss << allocs << " allocs, " << frees << " frees, " << bytes << " bytes";
+  return oss.str();
+}
+
+std::vector<stats::KindStats> stats::objects() {
+  Totals sum;
+  {
+    std::lock_guard<std::mutex> guard(enlisted_lock);
+    sum = total();
+  }
+
+  std::vector<KindStats> found;
+  for (size_t i = 0; i <= env::ENV_KIND; i++) {
+    uint64_t allocs = sum.allocs[i];
+    if (allocs == 0) {
+      continue;
+    }
+    uint64_t frees = sum.frees[i];
+    uint64_t peak = sum.peak[i];
+    // Another thread could free one after its allocation was read
+    uint64_t live = allocs > frees ? allocs - frees : 0;
+    found.push_back(KindStats{KINDS[i].name, allocs, frees,
+                              live * KINDS[i].size, peak * KINDS[i].size});
+  }
+  return found;
+}
+
+stats::KindStats stats::objects_of(const std::string &kind) {
+  for (const KindStats &found : objects()) {
+    if (found.kind == kind) {
+      return found;
+    }
+  }
+  return KindStats{kind, 0, 0, 0, 0};
+}
+
+std::string stats::objects_report() {
+  std::ostringstream oss;
+  oss << std::left << std::setw(12) << "kind" << std::right << std::setw(12)
+      << "allocs" << std::setw(12) << "frees" << std::setw(14) << "live bytes"
+      << std::setw(14) << "peak bytes"
+      << "\n";
+  for (const KindStats &kind : objects()) {
+    oss << std::left << std::setw(12) << kind.kind << std::right
+        << std::setw(12) << kind.allocs << std::setw(12) << kind.frees
+        << std::setw(14) << kind.live_bytes << std::setw(14) << kind.peak_bytes
+        << "\n";
+  }
+  return oss.str();
+}
@@ -0,0 +1,25 @@
+#include "arena.h"
+
+ast::Arena::Arena() : chunk_used(0), chunk_size(0), allocations(0) {}
+
+ast::Arena::~Arena() {
+  for (auto chunk = chunks.begin(); chunk != chunks.end(); chunk++) {
+    delete[] * chunk;
+  }
+}
+
+void *ast::Arena::allocate(size_t size, size_t align) {
+  allocations++;
+
+  // Chunks start out aligned for anything, so only the offset needs rounding
+  size_t offset = (chunk_used + align - 1) & ~(align - 1);
+  if (chunks.empty() || offset + size > chunk_size) {
+    // Anything bigger than a chunk gets a chunk of its own
+    chunk_size = size > CHUNK_SIZE ? size : CHUNK_SIZE;
+    chunks.push_back(new char[chunk_size]);
+    offset = 0;
+  }
+
+  chunk_used = offset + size;
+  return chunks.back() + offset;
+}
@@ -5,11 +5,22 @@ ast::NullNodeException nullNodeExc = ast::NullNodeException();
 ast::EmptyConditionListException emptyCondExc =
     ast::EmptyConditionListException();
 
+namespace {
+
+// A copy of a literal's token that points at text the node owns, rather than
+// into the source (literals aren't interned, see token.h)
+Token owning(const Token &token, const std::string &text) {
+  return Token::fixed(token.get_type(), text, token.get_column(),
+                      token.get_line());
+}
+
+}  // namespace
+
 /*************/
 /*** Block ***/
 /*************/
 
-ast::Block::Block(Token token) { this->token = token; }
+ast::Block::Block(Token token) : slot_count(0) { this->token = token; }
 
 void ast::Block::push_node(node_ptr node) {
   if (node == NULL) {
@@ -40,11 +51,14 @@ ast::node_type ast::Block::_type() { return ast::BLOCK; }
 /*** Identifier **/
 /******************/
 
-ast::Identifier::Identifier(){};
+ast::Identifier::Identifier()
+    : symbol(Token::NO_SYMBOL), depth(-1), slot(-1){};
 
-ast::Identifier::Identifier(Token token, std::string value) {
+ast::Identifier::Identifier(Token token, std::string value)
+    : depth(-1), slot(-1) {
   this->token = token;
   this->value = value;
+  this->symbol = SymbolTable::intern(value);
 }
 
 std::string ast::Identifier::to_string() { return "IDENT(" + value + ")"; }
@@ -123,8 +137,10 @@ ast::node_type ast::Return::_type() { return ast::RETURN; }
 /***********************/
 
 ast::Integer::Integer(Token token, int64_t value) {
-  this->token = token;
   this->value = value;
+  this->text = token.get_literal();
+  this->token = owning(token, this->text);
+  this->constant = obj::make_integer(value);
 }
 
 std::string ast::Integer::to_string() { return std::to_string(value); }
@@ -151,6 +167,10 @@ ast::node_type ast::Bool::_type() { return ast::BOOLEAN; }
 ast::Option::Option(Token token, std::string value) {
   this->token = token;
   this->value = value;
+  // The name is shared with the Identifier too, so that an option can be used
+  // anywhere an identifier is expected
+  this->Identifier::value = value;
+  this->symbol = SymbolTable::intern(value);
 }
 
 std::string ast::Option::to_string() { return this->value; }
@@ -162,8 +182,9 @@ ast::node_type ast::Option::_type() { return ast::OPTION; }
 /**********************/
 
 ast::String::String(Token token, std::string value) {
-  this->token = token;
   this->value = value;
+  this->token = owning(token, this->value);
+  this->constant = pool::make<obj::String>(value);
 }
 
 std::string ast::String::to_string() { return "\"" + this->value + "\""; }
@@ -176,7 +197,7 @@ ast::node_type ast::String::_type() { return ast::STRING; }
 
 ast::List::List(Token token, ast::node_list values) {
   this->token = token;
-  this->values = values;
+  this->values = std::move(values);
 }
 
 std::string ast::List::to_string() {
@@ -351,7 +372,7 @@ void ast::IfElse::push_condition_set(node_ptr condition,
 ast::Function::Function(Token token, ast::param_list params,
                         ast::block_ptr body) {
   this->token = token;
-  this->params = params;
+  this->params = std::move(params);
   this->body = body;
 }
 
@@ -382,7 +403,7 @@ ast::node_type ast::Function::_type() { return ast::FUNCTION; }
 ast::Call::Call(Token token, ast::node_ptr function, ast::node_list args) {
   this->token = token;
   this->function = function;
-  this->args = args;
+  this->args = std::move(args);
 }
 
 std::string ast::Call::to_string() {
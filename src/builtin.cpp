@@ -1,19 +1,44 @@
 #include "builtin.h"
-
-builtin_map Builtins::all_builtins = {
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <sstream>
+#include <thread>
+#include "thread_pool.h"
+
+const obj::bool_ptr TRUE_OBJ = pool::make<obj::Bool>(true);
+const obj::bool_ptr FALSE_OBJ = pool::make<obj::Bool>(false);
+const obj::opt_ptr NONE_OBJ = pool::make<obj::Option>();
+
+const builtin_map Builtins::all_builtins = {
     // Builtin mappings
-    {"len", &len},     {"size", &len},  {"count", &len},
-    {"print", &print}, {"each", &each}, {"map", &map},
+    {SymbolTable::intern("len"), &len},
+    {SymbolTable::intern("size"), &len},
+    {SymbolTable::intern("count"), &len},
+    {SymbolTable::intern("print"), &print},
+    {SymbolTable::intern("hash"), &hash},
+    {SymbolTable::intern("each"), &each},
+    {SymbolTable::intern("map"), &map},
+    {SymbolTable::intern("pmap"), &pmap},
+    {SymbolTable::intern("stats"), &object_stats},
 };
 
-bool Builtins::is_builtin(std::string name) {
+bool Builtins::is_builtin(symbol_id name) {
   return Builtins::all_builtins.count(name) > 0;
 }
 
-BI Builtins::get_builtin(std::string name) {
+bool Builtins::is_builtin(const std::string &name) {
+  return is_builtin(SymbolTable::intern(name));
+}
+
+BI Builtins::get_builtin(symbol_id name) {
   return Builtins::all_builtins.at(name);
 }
 
+BI Builtins::get_builtin(const std::string &name) {
+  return get_builtin(SymbolTable::intern(name));
+}
+
 /***********/
 /*** LEN ***/
 /***********/
@@ -23,7 +48,7 @@ BI Builtins::get_builtin(std::string name) {
 // key/value pairs in the map, or 1/0 for a filled/none option respectively.
 // Alias: size, count
 
-obj::obj_ptr len(obj::obj_list args) {
+obj::obj_ptr len(const obj::obj_list &args) {
   if (args.size() != 1) {
     throw InvalidArgsException("len(): Expected 1 argument, got " +
                                args.size());
@@ -33,32 +58,24 @@ obj::obj_ptr len(obj::obj_list args) {
   uint64_t output = 0;
   switch (arg->_type()) {
     case obj::LIST: {
-      obj::arr_ptr list = std::dynamic_pointer_cast<obj::List>(arg);
+      obj::arr_ptr list = fast_cast<obj::List>(arg);
       output = list->values.size();
     } break;
     case obj::STRING: {
-      obj::str_ptr str = std::dynamic_pointer_cast<obj::String>(arg);
-      output = str->value.size();
+      obj::str_ptr str = fast_cast<obj::String>(arg);
+      output = str->size();
     } break;
     case obj::MAP: {
-      obj::map_ptr map = std::dynamic_pointer_cast<obj::Map>(arg);
+      obj::map_ptr map = fast_cast<obj::Map>(arg);
       output = map->pairs.size();
     } break;
     case obj::OPTION: {
-      obj::opt_ptr opt = std::dynamic_pointer_cast<obj::Option>(arg);
+      obj::opt_ptr opt = fast_cast<obj::Option>(arg);
       output = (int)(opt != NONE_OBJ);
     } break;
     case obj::RANGE: {
-      obj::range_ptr range = std::dynamic_pointer_cast<obj::Range>(arg);
-      int64_t start, end;
-      start = range->start->value;
-      end = range->end->value;
-      // Adding one since no matter what, a range is inclusive
-      if (start < end) {
-        output = end - start + 1;
-      } else {
-        output = start - end + 1;
-      }
+      obj::range_ptr range = fast_cast<obj::Range>(arg);
+      output = range->size();
     } break;
     default: {
       throw InvalidArgsException("len(): Invalid argument type " +
@@ -66,7 +83,7 @@ obj::obj_ptr len(obj::obj_list args) {
                                  " for builtin 'len'.");
     }
   }
-  return obj::obj_ptr(new obj::Integer(output));
+  return obj::make_integer(output);
 }
 
 /*************/
@@ -76,7 +93,7 @@ obj::obj_ptr len(obj::obj_list args) {
 // print() outputs a string made of every passed string object, joining first
 // with spaces. Returns the full constructed string as a string object;
 
-obj::obj_ptr print(obj::obj_list args) {
+obj::obj_ptr print(const obj::obj_list &args) {
   if (args.size() == 0) {
     throw InvalidArgsException("print(): Expected more arguments than 0.");
   }
@@ -91,7 +108,7 @@ obj::obj_ptr print(obj::obj_list args) {
 
   std::string str = oss.str();
   std::cout << str << "\n";
-  return obj::str_ptr(new obj::String(str));
+  return pool::make<obj::String>(str);
 }
 
 /************/
@@ -103,13 +120,13 @@ obj::obj_ptr print(obj::obj_list args) {
 // single element.
 // Returns the hash as an integer object.
 
-obj::obj_ptr hash(obj::obj_list args) {
+obj::obj_ptr hash(const obj::obj_list &args) {
   if (args.size() != 1) {
     throw InvalidArgsException("hash(): Expected 1 argument, got " +
                                args.size());
   }
 
-  return obj::int_ptr(new obj::Integer(args.at(0)->hash()));
+  return obj::make_integer(args.at(0)->hash());
 }
 
 /************/
@@ -130,7 +147,9 @@ obj::obj_ptr hash(obj::obj_list args) {
 // Returns the iterable. The returned values from the callback function are
 // discarded.
 
-obj::obj_ptr each(obj::obj_list args) { return iterate_over(args, false); }
+obj::obj_ptr each(const obj::obj_list &args) {
+  return iterate_over(args, false);
+}
 
 /***********/
 /*** MAP ***/
@@ -140,13 +159,168 @@ obj::obj_ptr each(obj::obj_list args) { return iterate_over(args, false); }
 // return is a list made of the returns from each pass. There are specifics
 // depending on the iterable used, but the map output is always a list.
 
-obj::obj_ptr map(obj::obj_list args) { return iterate_over(args, true); }
+obj::obj_ptr map(const obj::obj_list &args) { return iterate_over(args, true); }
+
+/************/
+/*** PMAP ***/
+/************/
+
+// pmap() takes the same arguments as map() and gives back the same list, but
+// the calls are spread across the shared thread pool. Every call knows its
+// index up front, so each one writes straight into its own slot of the output
+// and the results come out in order without any locking or merging.
+//
+// The calls can run in any order and at the same time, so the callback has to
+// be pure: reading outer variables is fine, but assigning to them, or changing
+// a list or map that another call can see, is not safe. Anything it throws is
+// rethrown once the rest of the calls have finished.
+
+namespace {
+// See set_pmap_pool() in builtin.h
+std::atomic<ThreadPool *> pmap_pool(nullptr);
+}  // namespace
+
+void set_pmap_pool(ThreadPool *pool) { pmap_pool.store(pool); }
+
+obj::obj_ptr pmap(const obj::obj_list &args) {
+  if (args.size() != 2) {
+    throw InvalidArgsException(
+        "Pmap requires one iterable and one function or builtin");
+  }
+
+  obj::obj_ptr callback = args[1];
+  if (callback->_type() != obj::FUNCTION && callback->_type() != obj::BUILTIN) {
+    throw InvalidArgsException(
+        "Callback must be a function or builtin, received " +
+        obj::type_to_string(callback->_type()));
+  }
+
+  // Each chunk fills its own argument frame for element i, the same way the
+  // iterate_* helpers do
+  obj::obj_ptr iterable = args[0];
+  size_t count = 0;
+  std::function<void(size_t, obj::value_list &)> fill;
+  switch (iterable->_type()) {
+    case obj::LIST: {
+      auto list_obj = fast_cast<obj::List>(iterable);
+      count = list_obj->values.size();
+      fill = [list_obj](size_t i, obj::value_list &frame) {
+        frame[0] = obj::Value(list_obj->values[i]);
+        frame[1] = obj::Value::integer(i);
+      };
+    } break;
+    case obj::STRING: {
+      auto str_obj = fast_cast<obj::String>(iterable);
+      const std::string &text = str_obj->get_value();
+      count = text.size();
+      fill = [&text](size_t i, obj::value_list &frame) {
+        frame[0] = obj::Value(obj::make_char(text[i]));
+        frame[1] = obj::Value::integer(i);
+      };
+    } break;
+    case obj::RANGE: {
+      auto range_ptr = fast_cast<obj::Range>(iterable);
+      count = range_ptr->size();
+      int64_t start = range_ptr->start;
+      int64_t mod = range_ptr->forward() ? 1 : -1;
+      fill = [start, mod](size_t i, obj::value_list &frame) {
+        frame[0] = obj::Value::integer(start + mod * static_cast<int64_t>(i));
+        frame[1] = obj::Value::integer(i);
+      };
+    } break;
+    case obj::MAP: {
+      auto map_ptr = fast_cast<obj::Map>(iterable);
+      count = map_ptr->pairs.size();
+      fill = [map_ptr](size_t i, obj::value_list &frame) {
+        const obj::ObjMap::Entry &entry = map_ptr->pairs.entry_at(i);
+        frame[0] = obj::Value(entry.key);
+        frame[1] = obj::Value(entry.value);
+        frame[2] = obj::Value::integer(i);
+      };
+    } break;
+    default:
+      throw InvalidArgsException("Pmap cannot accept a(n) " +
+                                 obj::type_to_string(iterable->_type()) +
+                                 " as its target");
+  }
+
+  size_t frame_size = iterable->_type() == obj::MAP ? 3 : 2;
+  obj::obj_list results(count);
+  auto run = [&](size_t begin, size_t end) {
+    // Hashes a worker cached during some earlier pmap may be out of date
+    obj::forget_nested_hashes();
+    obj::value_list frame(frame_size);
+    for (size_t i = begin; i < end; i++) {
+      fill(i, frame);
+      results[i] = applyFunction(callback, frame);
+    }
+  };
+
+  // On a single core there's nothing to gain, and it's better not to start the
+  // pool at all: once a second thread exists, every shared_ptr copy in the
+  // process pays for an atomic refcount.
+  ThreadPool *pool = pmap_pool.load();
+  if (pool == nullptr && std::thread::hardware_concurrency() > 1) {
+    pool = &ThreadPool::shared();
+  }
+  if (pool == nullptr) {
+    run(0, count);
+  } else {
+    // Small enough chunks that the workers can even out an uneven callback,
+    // but not so small that handing them out costs more than running them
+    size_t grain = std::max<size_t>(1, count / (pool->size() * 8));
+    pool->parallel_for(count, grain, run);
+    // And the callbacks may have changed something this thread had hashed
+    obj::forget_nested_hashes();
+  }
+
+  return pool::make<obj::List>(std::move(results));
+}
+
+/*************/
+/*** STATS ***/
+/*************/
+
+// stats() takes no arguments and returns what's been made so far, as a map
+// from each kind of object (by type name, plus "ENVIRONMENT") to a map of
+// "allocs", "frees", "live_bytes" and "peak_bytes". Kinds that were never made
+// are left out. The counts are for the whole process, not just this script,
+// so take them before and after and compare.
+//
+// The function can't be called stats here, since that's the namespace the
+// counters live in.
+
+obj::obj_ptr object_stats(const obj::obj_list &args) {
+  if (args.size() != 0) {
+    throw InvalidArgsException("stats(): Expected 0 arguments, got " +
+                               std::to_string(args.size()));
+  }
+
+  // Taken before anything's made for the result, so it doesn't count itself
+  std::vector<stats::KindStats> kinds = stats::objects();
+  auto field = [](obj::obj_map &pairs, const char *name, uint64_t value) {
+    pairs.insert(pool::make<obj::String>(name),
+                 obj::make_integer(value));
+  };
+
+  obj::obj_map by_kind;
+  for (const stats::KindStats &kind : kinds) {
+    obj::obj_map pairs;
+    field(pairs, "allocs", kind.allocs);
+    field(pairs, "frees", kind.frees);
+    field(pairs, "live_bytes", kind.live_bytes);
+    field(pairs, "peak_bytes", kind.peak_bytes);
+    by_kind.insert(pool::make<obj::String>(kind.kind),
+                   pool::make<obj::Map>(std::move(pairs)));
+  }
+  return pool::make<obj::Map>(std::move(by_kind));
+}
 
 /***************/
 /*** HELPERS ***/
 /***************/
 
-obj::obj_ptr iterate_over(obj::obj_list args, bool is_map) {
+obj::obj_ptr iterate_over(const obj::obj_list &args, bool is_map) {
   std::string name_of_this = is_map ? "Map" : "Each";
 
   if (args.size() != 2) {
@@ -161,23 +335,29 @@ obj::obj_ptr iterate_over(obj::obj_list args, bool is_map) {
         obj::type_to_string(callback->_type()));
   }
 
+  // Every iterable knows its size up front, so map() can make room for all of
+  // its results at once
   obj::obj_ptr iterable = args[0];
   obj::obj_list mapped_values;
   switch (iterable->_type()) {
     case obj::LIST: {
-      auto list_obj = std::dynamic_pointer_cast<obj::List>(iterable);
+      auto list_obj = fast_cast<obj::List>(iterable);
+      if (is_map) mapped_values.reserve(list_obj->values.size());
       iterate_list(list_obj, callback, mapped_values, is_map);
     } break;
     case obj::STRING: {
-      auto str_obj = std::dynamic_pointer_cast<obj::String>(iterable);
+      auto str_obj = fast_cast<obj::String>(iterable);
+      if (is_map) mapped_values.reserve(str_obj->size());
       iterate_string(str_obj, callback, mapped_values, is_map);
     } break;
     case obj::RANGE: {
-      auto range_ptr = std::dynamic_pointer_cast<obj::Range>(iterable);
+      auto range_ptr = fast_cast<obj::Range>(iterable);
+      if (is_map) mapped_values.reserve(range_ptr->size());
       iterate_range(range_ptr, callback, mapped_values, is_map);
     } break;
     case obj::MAP: {
-      auto map_ptr = std::dynamic_pointer_cast<obj::Map>(iterable);
+      auto map_ptr = fast_cast<obj::Map>(iterable);
+      if (is_map) mapped_values.reserve(map_ptr->pairs.size());
       iterate_map(map_ptr, callback, mapped_values, is_map);
     } break;
     default:
@@ -189,68 +369,74 @@ obj::obj_ptr iterate_over(obj::obj_list args, bool is_map) {
   // Since anything that wouldn't be caught by the switch would throw before
   // this point, I'm confident in returning without further validation
   if (is_map) {
-    return obj::arr_ptr(new obj::List(mapped_values));
+    return pool::make<obj::List>(std::move(mapped_values));
   }
   return iterable;
 }
 
-obj::obj_ptr iterate_list(obj::arr_ptr target, obj::obj_ptr callable,
+// Like the other iterators, this fills one argument frame and reuses it for
+// every call. The index goes in unboxed.
+obj::obj_ptr iterate_list(const obj::arr_ptr &target,
+                          const obj::obj_ptr &callable,
                           obj::obj_list& keep_list, bool keep) {
-  int64_t index = 0;
-  for (auto element = target->values.begin(); element != target->values.end();
-       element++, index++) {
+  // By position, since the callback can assign into the list
+  obj::value_list args(2);
+  for (size_t index = 0; index < target->values.size(); index++) {
     // Callback arguments
-    obj::int_ptr index_arg = obj::int_ptr(new obj::Integer(index));
-    obj::obj_list new_args{(*element), index_arg};
+    args[0] = obj::Value(target->values[index]);
+    args[1] = obj::Value::integer(index);
 
     // Run callback
-    obj::obj_ptr val = applyFunction(callable, new_args);
+    obj::obj_ptr val = applyFunction(callable, args);
     if (keep) {
-      keep_list.push_back(val);
+      keep_list.push_back(std::move(val));
     }
   }
 
   return target;
 }
 
-obj::obj_ptr iterate_string(obj::str_ptr target, obj::obj_ptr callable,
+obj::obj_ptr iterate_string(const obj::str_ptr &target,
+                            const obj::obj_ptr &callable,
                             obj::obj_list& keep_list, bool keep) {
-  int64_t index = 0;
-  for (auto ch = target->value.begin(); ch != target->value.end();
-       ch++, index++) {
+  const std::string &text = target->get_value();
+  obj::value_list args(2);
+  for (size_t index = 0; index < text.size(); index++) {
     // Callback arguments
-    std::string cur_char = std::string(1, *ch);
-    obj::str_ptr char_arg = obj::str_ptr(new obj::String(cur_char));
-    obj::int_ptr index_arg = obj::int_ptr(new obj::Integer(index));
-    obj::obj_list new_args{char_arg, index_arg};
+    args[0] = obj::Value(obj::make_char(text[index]));
+    args[1] = obj::Value::integer(index);
 
     // Run callback
-    obj::obj_ptr val = applyFunction(callable, new_args);
+    obj::obj_ptr val = applyFunction(callable, args);
     if (keep) {
-      keep_list.push_back(val);
+      keep_list.push_back(std::move(val));
     }
   }
 
   return target;
 }
 
-obj::obj_ptr iterate_range(obj::range_ptr target, obj::obj_ptr callable,
+obj::obj_ptr iterate_range(const obj::range_ptr &target,
+                           const obj::obj_ptr &callable,
                            obj::obj_list& keep_list, bool keep) {
   int64_t index = 0;
-  int64_t iter = target->start->value;
-  int64_t end = target->end->value;
+  int64_t iter = target->start;
+  int64_t end = target->end;
   bool forward = target->forward();
   int mod = forward ? 1 : -1;
+
+  // One argument frame for the whole loop. The numbers go in unboxed, so
+  // walking a range doesn't make any Integers unless the callback needs them.
+  obj::value_list args(2);
   while (true) {
     // Callback arguments
-    obj::int_ptr iter_arg = obj::int_ptr(new obj::Integer(iter));
-    obj::int_ptr index_arg = obj::int_ptr(new obj::Integer(index));
-    obj::obj_list new_args{iter_arg, index_arg};
+    args[0] = obj::Value::integer(iter);
+    args[1] = obj::Value::integer(index);
 
     // Run callback
-    obj::obj_ptr val = applyFunction(callable, new_args);
+    obj::obj_ptr val = applyFunction(callable, args);
     if (keep) {
-      keep_list.push_back(val);
+      keep_list.push_back(std::move(val));
     }
 
     index++;
@@ -263,27 +449,29 @@ obj::obj_ptr iterate_range(obj::range_ptr target, obj::obj_ptr callable,
   return target;
 }
 
-// NOTE: Although an index is maintained while iterating over a map, it should
-// be understood that there is no guarantee of ordering in a map, so the index
-// doesn't mean anything significant or correlate to the either key or value,
-// except to count how many loops have occurred. It can be useful in context,
-// but does not inherently signify anything.
-obj::obj_ptr iterate_map(obj::map_ptr target, obj::obj_ptr callable,
-                         obj::obj_list& keep_list, bool keep) {
-  int64_t index = 0;
-  for (auto iter = target->pairs.begin(); iter != target->pairs.end();
-       iter++, index++) {
-    // Callback arguments
-    obj::obj_pair kv_pair = iter->second;
-    obj::obj_ptr key_arg = kv_pair.first;
-    obj::obj_ptr val_arg = kv_pair.second;
-    obj::int_ptr index_arg = obj::int_ptr(new obj::Integer(index));
-    obj::obj_list new_args{key_arg, val_arg, index_arg};
+// Maps keep their insertion order, so the index passed to the callback is the
+// position of the key in the order the map was built.
+//
+// Walking by position instead of with an iterator, since the callback is free
+// to add keys to the map. Only the keys that were there when the loop started
+// are visited, so a callback that keeps adding keys still finishes.
+obj::obj_ptr iterate_map(const obj::map_ptr &target,
+                         const obj::obj_ptr &callable, obj::obj_list& keep_list,
+                         bool keep) {
+  size_t size = target->pairs.size();
+  obj::value_list args(3);
+  for (size_t i = 0; i < size; i++) {
+    // Callback arguments. The entry has to be copied out before the call, since
+    // adding keys can move it.
+    const obj::ObjMap::Entry &entry = target->pairs.entry_at(i);
+    args[0] = obj::Value(entry.key);
+    args[1] = obj::Value(entry.value);
+    args[2] = obj::Value::integer(i);
 
     // Run callback
-    obj::obj_ptr val = applyFunction(callable, new_args);
+    obj::obj_ptr val = applyFunction(callable, args);
     if (keep) {
-      keep_list.push_back(val);
+      keep_list.push_back(std::move(val));
     }
   }
 
@@ -0,0 +1,107 @@
+#include "bytecode.h"
+#include <iomanip>
+#include <sstream>
+
+std::string vm::opcode_string(vm::OpCode op) {
+  switch (op) {
+    case vm::OP_CONSTANT:
+      return "CONSTANT";
+    case vm::OP_TRUE:
+      return "TRUE";
+    case vm::OP_FALSE:
+      return "FALSE";
+    case vm::OP_NONE:
+      return "NONE";
+    case vm::OP_POP:
+      return "POP";
+    case vm::OP_GET_NAME:
+      return "GET_NAME";
+    case vm::OP_SET_NAME:
+      return "SET_NAME";
+    case vm::OP_GET_VAR:
+      return "GET_VAR";
+    case vm::OP_SET_VAR:
+      return "SET_VAR";
+    case vm::OP_LET:
+      return "LET";
+    case vm::OP_LET_OPTION:
+      return "LET_OPTION";
+    case vm::OP_LET_NONE:
+      return "LET_NONE";
+    case vm::OP_INFIX:
+      return "INFIX";
+    case vm::OP_PREFIX:
+      return "PREFIX";
+    case vm::OP_LIST:
+      return "LIST";
+    case vm::OP_MAP:
+      return "MAP";
+    case vm::OP_INDEX:
+      return "INDEX";
+    case vm::OP_INDEX_SET:
+      return "INDEX_SET";
+    case vm::OP_WRAP_OPTION:
+      return "WRAP_OPTION";
+    case vm::OP_JUMP:
+      return "JUMP";
+    case vm::OP_JUMP_IF_FALSE:
+      return "JUMP_IF_FALSE";
+    case vm::OP_LINE:
+      return "LINE";
+    case vm::OP_CLOSURE:
+      return "CLOSURE";
+    case vm::OP_CALL:
+      return "CALL";
+    case vm::OP_RETURN:
+      return "RETURN";
+    default:
+      return "UNKNOWN";
+  }
+}
+
+// Mostly for debugging the compiler. Nested protos are listed after the one
+// that owns them.
+std::string vm::Proto::disassemble() {
+  std::ostringstream oss;
+
+  for (size_t i = 0; i < code.size(); i++) {
+    Instruction ins = code[i];
+    oss << std::setw(4) << std::setfill('0') << i << " "
+        << opcode_string(ins.op) << " " << ins.arg;
+
+    switch (ins.op) {
+      case vm::OP_CONSTANT:
+        oss << " (" << constants[ins.arg].box()->inspect() << ")";
+        break;
+      case vm::OP_GET_NAME:
+      case vm::OP_SET_NAME:
+        oss << " (" << SymbolTable::name(names[ins.arg]) << ")";
+        break;
+      case vm::OP_GET_VAR:
+      case vm::OP_SET_VAR:
+      case vm::OP_LET:
+      case vm::OP_LET_OPTION:
+      case vm::OP_LET_NONE: {
+        const VarRef &var = vars[ins.arg];
+        oss << " (" << SymbolTable::name(var.name);
+        if (var.slot >= 0) {
+          oss << " @" << var.depth << ":" << var.slot;
+        }
+        oss << ")";
+      } break;
+      case vm::OP_INFIX:
+      case vm::OP_PREFIX:
+        oss << " (" << tokens[ins.arg].get_literal() << ")";
+        break;
+      default:
+        break;
+    }
+    oss << "\n";
+  }
+
+  for (size_t i = 0; i < protos.size(); i++) {
+    oss << "-- function " << i << " --\n" << protos[i]->disassemble();
+  }
+
+  return oss.str();
+}
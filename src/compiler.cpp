@@ -0,0 +1,302 @@
+#include "compiler.h"
+
+using namespace vm;
+
+Compiler::Compiler() : proto(new Proto()), depth(0) {}
+
+proto_ptr Compiler::compile_program(ast::block_ptr program) {
+  proto->is_script = true;
+  compile_block(program);
+  emit(OP_RETURN, 0, -1);
+  return proto;
+}
+
+proto_ptr Compiler::compile_function(ast::func_ptr func_node) {
+  compile_block(func_node->body);
+  emit(OP_RETURN, 0, -1);
+  return proto;
+}
+
+void Compiler::compile(ast::node_ptr node) {
+  switch (node->_type()) {
+    case ast::BLOCK: {
+      compile_block(fast_cast<ast::Block>(node));
+    } break;
+
+    case ast::IDENT: {
+      auto ident = fast_cast<ast::Identifier>(node);
+      // Builtins always win over variables, so they can be looked up once here
+      // instead of every time the identifier is reached
+      if (Builtins::is_builtin(ident->symbol)) {
+        BI bi = Builtins::get_builtin(ident->symbol);
+        obj::obj_ptr builtin =
+            pool::make<obj::Builtin>(bi, SymbolTable::name(ident->symbol));
+        emit(OP_CONSTANT, add_constant(builtin), 1);
+      } else {
+        emit_get(ident);
+      }
+    } break;
+
+    case ast::LET: {
+      compile_let(fast_cast<ast::Let>(node));
+    } break;
+
+    case ast::ASSIGN: {
+      auto assign = fast_cast<ast::Assign>(node);
+      compile(assign->expression);
+      emit_set(assign->name);
+    } break;
+
+    case ast::RETURN: {
+      auto ret = fast_cast<ast::Return>(node);
+      compile(ret->expression);
+      // Everything after a return is unreachable, so the value is treated as
+      // if it stayed on the stack to keep the depth of the surrounding block
+      // consistent
+      emit(OP_RETURN, 1, 0);
+    } break;
+
+    case ast::INTEGER: {
+      auto int_node = fast_cast<ast::Integer>(node);
+      obj::Value constant = obj::Value::integer(int_node->value);
+      emit(OP_CONSTANT, add_constant(constant), 1);
+    } break;
+
+    case ast::BOOLEAN: {
+      auto bool_node = fast_cast<ast::Bool>(node);
+      emit(bool_node->value ? OP_TRUE : OP_FALSE, 0, 1);
+    } break;
+
+    case ast::STRING: {
+      auto str_node = fast_cast<ast::String>(node);
+      emit(OP_CONSTANT, add_constant(str_node->constant), 1);
+    } break;
+
+    case ast::LIST: {
+      auto list_node = fast_cast<ast::List>(node);
+      for (auto &value : list_node->values) {
+        compile(value);
+      }
+      int size = list_node->values.size();
+      emit(OP_LIST, size, 1 - size);
+    } break;
+
+    case ast::MAP: {
+      auto map_node = fast_cast<ast::Map>(node);
+      for (auto &kv : map_node->key_value_pairs) {
+        compile(kv.first);
+        compile(kv.second);
+      }
+      int size = map_node->key_value_pairs.size();
+      emit(OP_MAP, size, 1 - 2 * size);
+    } break;
+
+    case ast::FUNCTION: {
+      auto func_node = fast_cast<ast::Function>(node);
+      Compiler func_compiler = Compiler();
+      proto->functions.push_back(func_node);
+      proto->protos.push_back(func_compiler.compile_function(func_node));
+      emit(OP_CLOSURE, proto->protos.size() - 1, 1);
+    } break;
+
+    case ast::PREFIX: {
+      auto prefix = fast_cast<ast::Prefix>(node);
+      compile(prefix->right);
+      emit(OP_PREFIX, add_token(prefix->op), 0);
+    } break;
+
+    case ast::INFIX: {
+      compile_infix(fast_cast<ast::Infix>(node));
+    } break;
+
+    case ast::GROUP: {
+      compile(fast_cast<ast::Group>(node)->expr);
+    } break;
+
+    case ast::CALL: {
+      auto call = fast_cast<ast::Call>(node);
+      compile(call->function);
+      for (auto &arg : call->args) {
+        compile(arg);
+      }
+      int argc = call->args.size();
+      emit(OP_CALL, argc, -argc);
+    } break;
+
+    case ast::INDEX: {
+      auto index = fast_cast<ast::Index>(node);
+      compile(index->left);
+      compile(index->index);
+      emit(OP_INDEX, 0, -1);
+    } break;
+
+    case ast::IF_ELSE: {
+      compile_if_else(fast_cast<ast::IfElse>(node));
+    } break;
+
+    default: {
+      throw CompileException("Unknown node type: " + node->to_string() +
+                             ", not sure how to compile.");
+    }
+  }
+}
+
+// A block leaves exactly one value behind: the value of its last expression.
+// Every other expression is popped as soon as it's done. An empty block has
+// no last expression, so it gives back none.
+void Compiler::compile_block(ast::block_ptr block) {
+  if (block->nodes.empty()) {
+    emit(OP_NONE, 0, 1);
+    return;
+  }
+
+  for (auto node = block->nodes.begin(); node != block->nodes.end(); node++) {
+    if (node != block->nodes.begin()) {
+      emit(OP_POP, 0, -1);
+    }
+    emit(OP_LINE, (*node)->token.get_line(), 0);
+    compile(*node);
+  }
+}
+
+void Compiler::compile_let(ast::let_ptr let) {
+  if (let->name->_type() != ast::OPTION) {
+    compile(let->expression);
+    emit(OP_LET, add_var(let->name), 0);
+    return;
+  }
+
+  if (let->expression == nullptr) {
+    emit(OP_LET_NONE, add_var(let->name), 1);
+  } else {
+    compile(let->expression);
+    emit(OP_LET_OPTION, add_var(let->name), 0);
+  }
+}
+
+void Compiler::compile_infix(ast::infix_ptr infix) {
+  // Assignment has to be caught before the left side gets compiled, since the
+  // variable (or the indexed value) is a target rather than a value
+  if (infix->op.get_type() == TokenType::ASSIGN) {
+    if (infix->left->_type() == ast::IDENT) {
+      auto ident = fast_cast<ast::Identifier>(infix->left);
+      compile(infix->right);
+      emit_set(ident);
+      return;
+    }
+
+    if (infix->left->_type() == ast::INDEX) {
+      auto index = fast_cast<ast::Index>(infix->left);
+      compile(index->left);
+      compile(index->index);
+      compile(infix->right);
+      emit(OP_INDEX_SET, 0, -2);
+      return;
+    }
+  }
+
+  compile(infix->left);
+  compile(infix->right);
+  emit(OP_INFIX, add_token(infix->op), -1);
+}
+
+// Each condition jumps past its block when falsy, and each block jumps to the
+// very end once it's done. Falling through every condition gives none, just
+// like evalIfElse.
+void Compiler::compile_if_else(ast::ifelse_ptr if_else) {
+  std::vector<uint32_t> end_jumps;
+
+  for (auto set = if_else->list.begin(); set != if_else->list.end(); set++) {
+    uint32_t skip_jump = 0;
+    bool has_condition = set->condition != nullptr;
+    if (has_condition) {
+      compile(set->condition);
+      skip_jump = emit(OP_JUMP_IF_FALSE, 0, -1);
+    }
+
+    compile_block(set->consequence);
+    if (!set->consequence->nodes.empty()) {
+      emit(OP_WRAP_OPTION, 0, 0);
+    }
+    end_jumps.push_back(emit(OP_JUMP, 0, 0));
+    // Only one of the branches ever leaves its value on the stack
+    depth--;
+
+    if (has_condition) {
+      patch_jump(skip_jump);
+    }
+  }
+
+  emit(OP_NONE, 0, 1);
+  for (auto jump : end_jumps) {
+    patch_jump(jump);
+  }
+}
+
+/***************/
+/*** Helpers ***/
+/***************/
+
+uint32_t Compiler::emit(OpCode op, uint32_t arg, int stack_effect) {
+  Instruction ins;
+  ins.op = op;
+  ins.arg = arg;
+  proto->code.push_back(ins);
+
+  depth += stack_effect;
+  if (depth > proto->max_stack) {
+    proto->max_stack = depth;
+  }
+
+  return proto->code.size() - 1;
+}
+
+// Points the jump at `at` to whatever instruction gets emitted next
+void Compiler::patch_jump(uint32_t at) {
+  proto->code[at].arg = proto->code.size();
+}
+
+uint32_t Compiler::add_constant(obj::Value constant) {
+  proto->constants.push_back(constant);
+  return proto->constants.size() - 1;
+}
+
+uint32_t Compiler::add_name(symbol_id name) {
+  auto found = name_indices.find(name);
+  if (found != name_indices.end()) {
+    return found->second;
+  }
+
+  proto->names.push_back(name);
+  uint32_t index = proto->names.size() - 1;
+  name_indices[name] = index;
+  return index;
+}
+
+// Lets don't share entries, since each one is only reached once per run
+uint32_t Compiler::add_var(ast::ident_ptr ident) {
+  proto->vars.push_back(
+      VarRef{ident->depth, ident->slot, ident->symbol, ident->shadows});
+  return proto->vars.size() - 1;
+}
+
+void Compiler::emit_get(ast::ident_ptr ident) {
+  if (ident->slot < 0) {
+    emit(OP_GET_NAME, add_name(ident->symbol), 1);
+  } else {
+    emit(OP_GET_VAR, add_var(ident), 1);
+  }
+}
+
+void Compiler::emit_set(ast::ident_ptr ident) {
+  if (ident->slot < 0) {
+    emit(OP_SET_NAME, add_name(ident->symbol), 0);
+  } else {
+    emit(OP_SET_VAR, add_var(ident), 0);
+  }
+}
+
+uint32_t Compiler::add_token(const Token &token) {
+  proto->tokens.push_back(token);
+  return proto->tokens.size() - 1;
+}
@@ -0,0 +1,72 @@
+#include <cstdlib>
+#include <new>
+#include "alloc_stats.h"
+
+/* Replaces the global operator new and delete with ones that count what they
+ * do in this thread's stats::ThreadCounts. This takes over the allocator of
+ * whatever it's linked into, so it's left out of LIBOBJECTS in the makefile
+ * and only goes into parth, the tests and the benchmarks. */
+
+namespace {
+
+void *counted_alloc(size_t size) {
+  stats::count_new(size);
+  // malloc(0) is allowed to return null, but new never is
+  void *ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void *counted_aligned_alloc(size_t size, std::align_val_t align) {
+  stats::count_new(size);
+  // aligned_alloc wants the size to be a multiple of the alignment
+  size_t alignment = static_cast<size_t>(align);
+  size_t rounded = (size + alignment - 1) / alignment * alignment;
+  void *ptr = std::aligned_alloc(alignment, rounded == 0 ? alignment : rounded);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void counted_free(void *ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  stats::count_delete();
+  std::free(ptr);
+}
+
+}  // namespace
+
+// Every form that allocates or frees is replaced, so nothing slips past the
+// counts and nothing allocated here is freed by the default (or the reverse).
+// The nothrow forms fall back on these by default.
+
+void *operator new(size_t size) { return counted_alloc(size); }
+void *operator new[](size_t size) { return counted_alloc(size); }
+void *operator new(size_t size, std::align_val_t align) {
+  return counted_aligned_alloc(size, align);
+}
+void *operator new[](size_t size, std::align_val_t align) {
+  return counted_aligned_alloc(size, align);
+}
+
+void operator delete(void *ptr) noexcept { counted_free(ptr); }
+void operator delete[](void *ptr) noexcept { counted_free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { counted_free(ptr); }
+void operator delete[](void *ptr, size_t) noexcept { counted_free(ptr); }
+void operator delete(void *ptr, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+void operator delete[](void *ptr, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+void operator delete(void *ptr, size_t, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
+void operator delete[](void *ptr, size_t, std::align_val_t) noexcept {
+  counted_free(ptr);
+}
@@ -4,46 +4,145 @@ using namespace env;
 
 Environment::Environment() {}
 Environment::Environment(env_ptr outer) : outer(outer) {}
+Environment::Environment(env_ptr outer, size_t slot_count)
+    : slots(slot_count), outer(outer) {}
 
-void Environment::init(const std::string &key, obj::obj_ptr value) {
-  if (this->store.find(key) == this->store.end()) {
-    this->store[key] = value;
-  } else {
-    throw InitVarException(key);
+/*************/
+/*** Slots ***/
+/*************/
+
+void Environment::init(size_t slot, symbol_id name, obj::Value value) {
+  // Environments that weren't sized by a scope (like the one a program is
+  // first run in) grow as their variables are declared
+  if (slot >= this->slots.size()) {
+    this->slots.resize(slot + 1);
+  }
+
+  if (!this->slots[slot].is_empty()) {
+    throw InitVarException(std::string(SymbolTable::name(name)));
+  }
+  this->slots[slot] = std::move(value);
+}
+
+void Environment::set(size_t depth, size_t slot, symbol_id name,
+                      obj::Value value,
+                      const std::vector<std::pair<int, int>> &shadows) {
+  Environment *scope = scope_at(depth);
+  if (slot < scope->slots.size() && !scope->slots[slot].is_empty()) {
+    scope->slots[slot] = std::move(value);
+    return;
+  }
+
+  for (const auto &shadowed : shadows) {
+    scope = scope_at(shadowed.first);
+    if (size_t(shadowed.second) < scope->slots.size() &&
+        !scope->slots[shadowed.second].is_empty()) {
+      scope->slots[shadowed.second] = std::move(value);
+      return;
+    }
+  }
+  set(name, std::move(value));
+}
+
+obj::Value Environment::get_value(size_t depth, size_t slot) {
+  Environment *scope = scope_at(depth);
+  if (slot >= scope->slots.size()) {
+    return obj::Value();
+  }
+  return scope->slots[slot];
+}
+
+obj::Value Environment::get_shadowed(
+    symbol_id name, const std::vector<std::pair<int, int>> &shadows) {
+  for (const auto &shadowed : shadows) {
+    obj::Value value = get_value(shadowed.first, shadowed.second);
+    if (!value.is_empty()) {
+      return value;
+    }
+  }
+  return get_value(name);
+}
+
+Environment *Environment::scope_at(size_t depth) {
+  Environment *scope = this;
+  for (; depth > 0; depth--) {
+    scope = scope->outer.get();
+  }
+  return scope;
+}
+
+/*************/
+/*** Names ***/
+/*************/
+
+void Environment::init(symbol_id key, obj::Value value) {
+  if (!this->store.emplace(key, std::move(value)).second) {
+    throw InitVarException(std::string(SymbolTable::name(key)));
   }
 }
 
-void Environment::set(const std::string &key, obj::obj_ptr value) {
-  if (this->store.find(key) != this->store.end()) {
-    this->store[key] = value;
-  } else if (this->outer != nullptr) {
-    this->outer->set(key, value);
-  } else {
-    std::cout << "Outer exists: " << (this->outer == nullptr) << std::endl;
-    throw NoVarException(key);
+void Environment::set(symbol_id key, obj::Value value) {
+  Environment *scope = this;
+  while (scope != nullptr) {
+    auto found = scope->store.find(key);
+    if (found != scope->store.end()) {
+      found->second = std::move(value);
+      return;
+    }
+    scope = scope->outer.get();
   }
+  throw NoVarException(std::string(SymbolTable::name(key)));
 }
 
-obj::obj_ptr Environment::get(const std::string key) {
-  if (this->store.find(key) != this->store.end()) {
-    return this->store[key];
-  } else if (this->outer != nullptr) {
-    return this->outer->get(key);
-  } else {
-    return nullptr;
+obj::Value Environment::get_value(symbol_id key) {
+  Environment *scope = this;
+  while (scope != nullptr) {
+    // Function scopes rarely have names of their own
+    if (!scope->store.empty()) {
+      auto found = scope->store.find(key);
+      if (found != scope->store.end()) {
+        return found->second;
+      }
+    }
+    scope = scope->outer.get();
   }
+  return obj::Value();
+}
+
+void Environment::init(const std::string &key, obj::Value value) {
+  init(SymbolTable::intern(key), std::move(value));
+}
+
+void Environment::set(const std::string &key, obj::Value value) {
+  set(SymbolTable::intern(key), std::move(value));
+}
+
+obj::obj_ptr Environment::get(const std::string &key) {
+  return get_value(key).box();
+}
+
+obj::Value Environment::get_value(const std::string &key) {
+  return get_value(SymbolTable::intern(key));
 }
 
 void Environment::inspect() {
   std::string out = "{ ";
 
-  std::unordered_map<std::string, obj::obj_ptr>::iterator iter;
+  for (size_t slot = 0; slot < this->slots.size(); slot++) {
+    if (this->slots[slot].is_empty()) {
+      continue;
+    }
+    out += "#" + std::to_string(slot) + ": ";
+    out += this->slots[slot].box()->inspect();
+    out += ", ";
+  }
 
+  std::unordered_map<symbol_id, obj::Value>::iterator iter;
   for (iter = this->store.begin(); iter != this->store.end(); iter++) {
-    out += iter->first + ": ";
-    out += iter->second->inspect();
+    out += std::string(SymbolTable::name(iter->first)) + ": ";
+    out += iter->second.box()->inspect();
     out += ", ";
   }
 
   std::cout << out << " }\n";
-}
\ No newline at end of file
+}
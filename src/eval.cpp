@@ -1,77 +1,76 @@
 #include "eval.h"
 
-obj::obj_ptr eval(ast::node_ptr node, env::env_ptr envir) {
+obj::obj_ptr eval(const ast::node_ptr &node, const env::env_ptr &envir) {
+  PROFILE_NODE(node->_type());
   switch (node->_type()) {
     case ast::BLOCK: {
-      ast::block_ptr block_node = std::dynamic_pointer_cast<ast::Block>(node);
+      ast::block_ptr block_node = fast_cast<ast::Block>(node);
       return evalBlock(block_node, envir);
     } break;
 
     case ast::IDENT: {
-      ast::ident_ptr ident_node =
-          std::dynamic_pointer_cast<ast::Identifier>(node);
-      return evalIdent(ident_node, envir);
+      ast::ident_ptr ident_node = fast_cast<ast::Identifier>(node);
+      return evalIdent(ident_node, envir).box();
     } break;
 
     case ast::LET: {
-      ast::let_ptr let_node = std::dynamic_pointer_cast<ast::Let>(node);
+      ast::let_ptr let_node = fast_cast<ast::Let>(node);
       return evalLet(let_node, envir);
     } break;
 
     case ast::RETURN: {
-      ast::return_ptr ret_node = std::dynamic_pointer_cast<ast::Return>(node);
+      ast::return_ptr ret_node = fast_cast<ast::Return>(node);
       obj::obj_ptr returned_value = eval(ret_node->expression, envir);
-      return obj::return_ptr(new obj::ReturnVal(returned_value));
+      return pool::make<obj::ReturnVal>(returned_value);
     } break;
 
     case ast::INTEGER: {
-      ast::int_ptr int_node = std::dynamic_pointer_cast<ast::Integer>(node);
+      ast::int_ptr int_node = fast_cast<ast::Integer>(node);
       return evalInteger(int_node);
     } break;
 
     case ast::BOOLEAN: {
-      ast::bool_ptr bool_node = std::dynamic_pointer_cast<ast::Bool>(node);
+      ast::bool_ptr bool_node = fast_cast<ast::Bool>(node);
       return evalBool(bool_node);
     } break;
 
     case ast::STRING: {
-      ast::str_ptr str_node = std::dynamic_pointer_cast<ast::String>(node);
+      ast::str_ptr str_node = fast_cast<ast::String>(node);
       return evalString(str_node);
     }
 
     case ast::LIST: {
-      ast::arr_ptr arr_node = std::dynamic_pointer_cast<ast::List>(node);
+      ast::arr_ptr arr_node = fast_cast<ast::List>(node);
       return evalList(arr_node, envir);
     }
 
     case ast::MAP: {
-      ast::map_ptr map_node = std::dynamic_pointer_cast<ast::Map>(node);
+      ast::map_ptr map_node = fast_cast<ast::Map>(node);
       return evalMap(map_node, envir);
     }
 
     case ast::FUNCTION: {
-      ast::func_ptr func_node = std::dynamic_pointer_cast<ast::Function>(node);
+      ast::func_ptr func_node = fast_cast<ast::Function>(node);
       return evalFunctionLiteral(func_node, envir);
     }
 
     case ast::PREFIX: {
-      ast::prefix_ptr prefix_node =
-          std::dynamic_pointer_cast<ast::Prefix>(node);
+      ast::prefix_ptr prefix_node = fast_cast<ast::Prefix>(node);
       return evalPrefix(prefix_node, envir);
     } break;
 
     case ast::INFIX: {
-      ast::infix_ptr infix_node = std::dynamic_pointer_cast<ast::Infix>(node);
+      ast::infix_ptr infix_node = fast_cast<ast::Infix>(node);
       return evalInfix(infix_node, envir);
     } break;
 
     case ast::GROUP: {
-      ast::grp_ptr group_node = std::dynamic_pointer_cast<ast::Group>(node);
+      ast::grp_ptr group_node = fast_cast<ast::Group>(node);
       return eval(group_node->expr, envir);
     }
 
     case ast::CALL: {
-      ast::call_ptr call_node = std::dynamic_pointer_cast<ast::Call>(node);
+      ast::call_ptr call_node = fast_cast<ast::Call>(node);
       obj::obj_ptr callable = eval(call_node->function, envir);
 
       if (callable->_type() != obj::FUNCTION &&
@@ -80,112 +79,198 @@ obj::obj_ptr eval(ast::node_ptr node, env::env_ptr envir) {
                                       obj::type_to_string(callable->_type()));
       }
 
-      obj::obj_list args = evalExpressionList(call_node->args, envir);
+      // Arguments go in as values, so `f(n - 1)` doesn't box n - 1
+      obj::value_list args;
+      args.reserve(call_node->args.size());
+      for (const ast::node_ptr &arg : call_node->args) {
+        args.push_back(evalValue(arg, envir));
+      }
       return applyFunction(callable, args);
     } break;
 
     case ast::INDEX: {
-      ast::index_ptr index_node = std::dynamic_pointer_cast<ast::Index>(node);
+      ast::index_ptr index_node = fast_cast<ast::Index>(node);
       return evalIndex(index_node->left, index_node->index, envir);
     } break;
 
     case ast::IF_ELSE: {
-      ast::ifelse_ptr ifelse_node =
-          std::dynamic_pointer_cast<ast::IfElse>(node);
+      ast::ifelse_ptr ifelse_node = fast_cast<ast::IfElse>(node);
       obj::obj_ptr if_else_val = evalIfElse(ifelse_node, envir);
       return if_else_val;
     } break;
 
     default: {
-      return obj::err_ptr(
-          new obj::Error("Unknown node type: " + node->to_string() +
-                         ", not sure how to evaluate."));
+      return pool::make<obj::Error>("Unknown node type: " +
+                                    node->to_string() +
+                                    ", not sure how to evaluate.");
+    }
+  }
+}
+
+// The same as eval(), but for the nodes that do arithmetic (or pass its
+// results along), the result is left unboxed. Everything else goes through
+// eval() and comes back wrapped, so only numbers that end up stored in an
+// object, or handed back out of eval(), ever become Integers.
+obj::Value evalValue(const ast::node_ptr &node, const env::env_ptr &envir) {
+  switch (node->_type()) {
+    case ast::INTEGER: {
+      PROFILE_NODE(ast::INTEGER);
+      // Holding on to the constant, so boxing it later costs nothing
+      return obj::Value(fast_cast<ast::Integer>(node)->constant);
+    }
+
+    case ast::IDENT: {
+      PROFILE_NODE(ast::IDENT);
+      return evalIdent(fast_cast<ast::Identifier>(node), envir);
+    }
+
+    case ast::LET: {
+      ast::let_ptr let_node = fast_cast<ast::Let>(node);
+      if (let_node->name->_type() == ast::OPTION) {
+        break;
+      }
+      PROFILE_NODE(ast::LET);
+      return evalIdentLet(let_node, envir);
     }
+
+    case ast::INFIX: {
+      PROFILE_NODE(ast::INFIX);
+      return evalInfixValue(fast_cast<ast::Infix>(node), envir);
+    }
+
+    case ast::PREFIX: {
+      ast::prefix_ptr prefix_node = fast_cast<ast::Prefix>(node);
+      if (prefix_node->op.get_type() != TokenType::MINUS) {
+        break;
+      }
+      PROFILE_NODE(ast::PREFIX);
+      obj::Value right = evalValue(prefix_node->right, envir);
+      if (right.is_int()) {
+        return obj::Value::integer(-right.as_int());
+      }
+      return obj::Value(evalPrefixOperator(prefix_node->op, right.box()));
+    }
+
+    case ast::GROUP: {
+      PROFILE_NODE(ast::GROUP);
+      return evalValue(fast_cast<ast::Group>(node)->expr, envir);
+    }
+
+    default:
+      break;
   }
+  return obj::Value(eval(node, envir));
 }
 
-obj::obj_ptr evalBlock(ast::block_ptr block_node, env::env_ptr envir) {
-  obj::obj_ptr result;
+// Only an error or a return ends a block early, and neither is ever unboxed
+static bool endsBlock(const obj::Value &result) {
+  if (!result.is_object()) {
+    return false;
+  }
+  obj::obj_type result_type = result.object()->_type();
+  return result_type == obj::ERROR || result_type == obj::RETURN_VAL;
+}
 
+obj::obj_ptr evalBlock(const ast::block_ptr &block_node,
+                       const env::env_ptr &envir) {
+  obj::Value result;
+
+  sample::CallStack &stack = sample::call_stack();
   ast::node_list::iterator node = block_node->nodes.begin();
   while (node != block_node->nodes.end()) {
+    stack.at_line((*node)->token.get_line());
     // Dereferencing a smart pointer seems like an oxymoron
-    result = eval(*node, envir);
+    result = evalValue(*node, envir);
 
-    if (result != nullptr) {
-      obj::obj_type result_type = result->_type();
-      if (result_type == obj::ERROR || result_type == obj::RETURN_VAL) {
-        return result;
-      }
+    if (endsBlock(result)) {
+      return result.object();
     }
 
     node++;
   }
 
-  return result;
+  // Only the block's last value is ever boxed
+  return result.box();
+}
+
+obj::Value evalIdent(const ast::ident_ptr &ident, const env::env_ptr &envir) {
+  if (ident->slot < 0) {
+    return lookupIdent(ident->symbol, envir);
+  }
+
+  obj::Value value = envir->get_value(ident->depth, ident->slot);
+  if (value.is_empty()) {
+    value = envir->get_shadowed(ident->symbol, ident->shadows);
+    if (value.is_empty()) {
+      throw NoVarException(ident->value);
+    }
+  }
+  return value;
 }
 
-obj::obj_ptr evalIdent(ast::ident_ptr ident, env::env_ptr envir) {
+obj::Value lookupIdent(symbol_id name, const env::env_ptr &envir) {
   // First gotta check if this ident belongs to a builtin
 
-  if (Builtins::is_builtin(ident->value)) {
-    BI bi = Builtins::get_builtin(ident->value);
-    return obj::builtin_ptr(new obj::Builtin(bi));
+  if (Builtins::is_builtin(name)) {
+    BI bi = Builtins::get_builtin(name);
+    return pool::make<obj::Builtin>(bi, SymbolTable::name(name));
   }
 
-  obj::obj_ptr value = envir->get(ident->value);
+  obj::Value value = envir->get_value(name);
 
-  if (value != nullptr) {
-    return value;
-  } else {
-    std::cout << "No such identifier " << ident->value
-              << ". Must be a builtin?\n";
-    return value;
+  if (value.is_empty()) {
+    throw NoVarException(std::string(SymbolTable::name(name)));
   }
+  return value;
 }
 
-obj::obj_ptr evalLet(ast::let_ptr let, env::env_ptr envir) {
+obj::obj_ptr evalLet(const ast::let_ptr &let, const env::env_ptr &envir) {
   if (let->name->_type() == ast::OPTION) {
     return evalOptLet(let, envir);
   } else {
-    return evalIdentLet(let, envir);
+    return evalIdentLet(let, envir).box();
   }
 }
 
-obj::obj_ptr evalIdentLet(ast::let_ptr let, env::env_ptr envir) {
-  obj::obj_ptr right = eval(let->expression, envir);
-  if (right->_type() != obj::ERROR) {
-    envir->init(let->name->value, right);
+obj::Value evalIdentLet(const ast::let_ptr &let, const env::env_ptr &envir) {
+  obj::Value right = evalValue(let->expression, envir);
+  if (!isError(right)) {
+    bindIdent(let->name, right, envir);
   }
   return right;
 }
 
-obj::obj_ptr evalOptLet(ast::let_ptr let, env::env_ptr envir) {
-  // Casting is required. Attempting to access `value` won't work otherwise. I'm
-  // not certain why this is, but I do not question Bjarne Stroustrup
-  std::string name = std::dynamic_pointer_cast<ast::Option>(let->name)->value;
-
+obj::obj_ptr evalOptLet(const ast::let_ptr &let, const env::env_ptr &envir) {
   if (let->expression != nullptr) {
     obj::obj_ptr right = eval(let->expression, envir);
     if (right->_type() != obj::ERROR) {
-      obj::opt_ptr opt = obj::opt_ptr(new obj::Option(right));
-      envir->init(name, opt);
+      obj::opt_ptr opt = pool::make<obj::Option>(right);
+      bindIdent(let->name, opt, envir);
       return opt;
     } else {
       return right;
     }
   } else {
     obj::opt_ptr opt = NONE_OBJ;
-    envir->init(name, opt);
+    bindIdent(let->name, opt, envir);
     return opt;
   }
 }
 
-obj::int_ptr evalInteger(ast::int_ptr int_node) {
-  return obj::int_ptr(new obj::Integer(int_node->value));
+void bindIdent(const ast::ident_ptr &ident, obj::Value value,
+               const env::env_ptr &envir) {
+  if (ident->slot < 0) {
+    envir->init(ident->symbol, std::move(value));
+  } else {
+    envir->init(ident->slot, ident->symbol, std::move(value));
+  }
+}
+
+obj::int_ptr evalInteger(const ast::int_ptr &int_node) {
+  return int_node->constant;
 }
 
-obj::bool_ptr evalBool(ast::bool_ptr bool_node) {
+obj::bool_ptr evalBool(const ast::bool_ptr &bool_node) {
   if (bool_node->value) {
     return TRUE_OBJ;
   } else {
@@ -193,71 +278,91 @@ obj::bool_ptr evalBool(ast::bool_ptr bool_node) {
   };
 }
 
-obj::str_ptr evalString(ast::str_ptr str_node) {
-  return obj::str_ptr(new obj::String(str_node->value));
+obj::str_ptr evalString(const ast::str_ptr &str_node) {
+  return str_node->constant;
 }
 
-obj::arr_ptr evalList(ast::arr_ptr arr_node, env::env_ptr envir) {
+obj::arr_ptr evalList(const ast::arr_ptr &arr_node, const env::env_ptr &envir) {
   obj::obj_list elements = evalExpressionList(arr_node->values, envir);
-  return obj::arr_ptr(new obj::List(elements));
+  return pool::make<obj::List>(elements);
 }
 
-obj::map_ptr evalMap(ast::map_ptr map_node, env::env_ptr envir) {
+obj::map_ptr evalMap(const ast::map_ptr &map_node, const env::env_ptr &envir) {
   obj::obj_map evaluated_kvs;
+  evaluated_kvs.reserve(map_node->key_value_pairs.size());
 
   ast::kv_list::iterator iter;
   for (iter = map_node->key_value_pairs.begin();
        iter < map_node->key_value_pairs.end(); iter++) {
-    obj::obj_ptr key_obj, val_obj;
-
-    key_obj = eval(iter->first, envir);
-    if (key_obj->_type() == obj::FUNCTION || key_obj->_type() == obj::BUILTIN) {
-      throw InvalidKeyException("Cannot have map key of type: " +
-                                obj::type_to_string(key_obj->_type()));
-    }
-
-    val_obj = eval(iter->second, envir);
+    obj::obj_ptr key_obj = eval(iter->first, envir);
+    obj::obj_ptr val_obj = eval(iter->second, envir);
+    insertMapPair(evaluated_kvs, key_obj, val_obj);
+  }
 
-    obj::obj_pair kv_pair;
-    kv_pair.first = key_obj;
-    kv_pair.second = val_obj;
+  return pool::make<obj::Map>(std::move(evaluated_kvs));
+}
 
-    uint64_t key_hash = key_obj->hash();
-    evaluated_kvs[key_hash] = kv_pair;
+void insertMapPair(obj::obj_map &pairs, const obj::obj_ptr &key_obj,
+                   const obj::obj_ptr &val_obj) {
+  if (key_obj->_type() == obj::FUNCTION || key_obj->_type() == obj::BUILTIN) {
+    throw InvalidKeyException("Cannot have map key of type: " +
+                              obj::type_to_string(key_obj->_type()));
   }
 
-  return obj::map_ptr(new obj::Map(evaluated_kvs));
+  pairs.insert(key_obj, val_obj);
+}
+
+obj::func_ptr evalFunctionLiteral(const ast::func_ptr &func_node,
+                                  const env::env_ptr &envir) {
+  return pool::make<obj::Function>(func_node, envir);
 }
 
-obj::func_ptr evalFunctionLiteral(ast::func_ptr func_node, env::env_ptr envir) {
-  return obj::func_ptr(new obj::Function(func_node, envir));
+obj::obj_ptr evalInfix(const ast::infix_ptr &infix_node,
+                       const env::env_ptr &envir) {
+  return evalInfixValue(infix_node, envir).box();
 }
 
 // There may be a cleaner way to evaluate infix expressions, but that's for
 // another day
-obj::obj_ptr evalInfix(ast::infix_ptr infix_node, env::env_ptr envir) {
+obj::Value evalInfixValue(const ast::infix_ptr &infix_node,
+                          const env::env_ptr &envir) {
   // Special cases first
-  Token op = infix_node->op;
-  ast::node_ptr left_node = infix_node->left;
-  ast::node_ptr right_node = infix_node->right;
+  const Token &op = infix_node->op;
+  const ast::node_ptr &left_node = infix_node->left;
+  const ast::node_ptr &right_node = infix_node->right;
 
   // Assignment needs to be checked first, since we don't want to evaluate the
   // variable
 
   if (left_node->_type() == ast::IDENT && op.get_type() == TokenType::ASSIGN) {
-    ast::ident_ptr left = std::dynamic_pointer_cast<ast::Identifier>(left_node);
+    ast::ident_ptr left = fast_cast<ast::Identifier>(left_node);
     return evalAssign(left, right_node, envir);
   }
 
   if (left_node->_type() == ast::INDEX && op.get_type() == TokenType::ASSIGN) {
-    ast::index_ptr left = std::dynamic_pointer_cast<ast::Index>(left_node);
-    return evalIndexAssign(left, right_node, envir);
+    ast::index_ptr left = fast_cast<ast::Index>(left_node);
+    return obj::Value(evalIndexAssign(left, right_node, envir));
   }
 
-  obj::obj_ptr left_eval = eval(left_node, envir);
-  obj::obj_ptr right_eval = eval(right_node, envir);
+  obj::Value left = evalValue(left_node, envir);
+  obj::Value right = evalValue(right_node, envir);
+
+  // Two numbers, and an operator that works on their values (the logical and
+  // range operators look at what the operands are first)
+  TokenType type = op.get_type();
+  if (left.is_int() && right.is_int() && type != TokenType::DOUBLE_AMP &&
+      type != TokenType::DOUBLE_PIPE && type != TokenType::DOUBLE_DOT &&
+      type != TokenType::TRIPLE_DOT) {
+    return evalIntegerInfixValue(op, left.as_int(), right.as_int());
+  }
+  return obj::Value(evalInfixOperator(op, left.box(), right.box()));
+}
 
-  // Next, we can check any other operator-dependent expressions
+// Everything after the operands have been evaluated. Split out from evalInfix
+// so that the VM can share the exact same operator semantics.
+obj::obj_ptr evalInfixOperator(const Token &op, const obj::obj_ptr &left_eval,
+                               const obj::obj_ptr &right_eval) {
+  // Operator-dependent expressions come first
 
   if (op.get_type() == TokenType::DOUBLE_AMP ||
       op.get_type() == TokenType::DOUBLE_PIPE) {
@@ -275,46 +380,51 @@ obj::obj_ptr evalInfix(ast::infix_ptr infix_node, env::env_ptr envir) {
 
   if (left_eval->_type() == obj::INTEGER &&
       right_eval->_type() == obj::INTEGER) {
-    obj::int_ptr left = std::dynamic_pointer_cast<obj::Integer>(left_eval);
-    obj::int_ptr right = std::dynamic_pointer_cast<obj::Integer>(right_eval);
+    obj::int_ptr left = fast_cast<obj::Integer>(left_eval);
+    obj::int_ptr right = fast_cast<obj::Integer>(right_eval);
     return evalIntegerInfixOperator(op, left, right);
   }
 
   if (left_eval->_type() == obj::BOOLEAN &&
       right_eval->_type() == obj::BOOLEAN) {
-    obj::bool_ptr left = std::dynamic_pointer_cast<obj::Bool>(left_eval);
-    obj::bool_ptr right = std::dynamic_pointer_cast<obj::Bool>(right_eval);
+    obj::bool_ptr left = fast_cast<obj::Bool>(left_eval);
+    obj::bool_ptr right = fast_cast<obj::Bool>(right_eval);
     return evalBoolInfixOperator(op, left, right);
   }
 
   if (left_eval->_type() == obj::STRING && right_eval->_type() == obj::STRING) {
-    obj::str_ptr left = std::dynamic_pointer_cast<obj::String>(left_eval);
-    obj::str_ptr right = std::dynamic_pointer_cast<obj::String>(right_eval);
+    obj::str_ptr left = fast_cast<obj::String>(left_eval);
+    obj::str_ptr right = fast_cast<obj::String>(right_eval);
     return evalStringInfixOperator(op, left, right);
   }
 
   if (left_eval->_type() == obj::LIST && right_eval->_type() == obj::LIST) {
-    obj::arr_ptr left = std::dynamic_pointer_cast<obj::List>(left_eval);
-    obj::arr_ptr right = std::dynamic_pointer_cast<obj::List>(right_eval);
+    obj::arr_ptr left = fast_cast<obj::List>(left_eval);
+    obj::arr_ptr right = fast_cast<obj::List>(right_eval);
     return evalListInfixOperator(op, left, right);
   }
 
-  std::string message =
-      "No such operation " + ast::node_type_string(left_node->_type()) + " " +
-      op.get_literal() + " " + ast::node_type_string(right_node->_type());
+  std::string message = "No such operation " +
+                        obj::type_to_string(left_eval->_type()) + " " +
+                        op.get_literal() + " " +
+                        obj::type_to_string(right_eval->_type());
   throw NoSuchOperatorException(message);
 }
 
-obj::obj_ptr evalPrefix(ast::prefix_ptr prefix_node, env::env_ptr envir) {
-  Token op = prefix_node->op;
+obj::obj_ptr evalPrefix(const ast::prefix_ptr &prefix_node,
+                        const env::env_ptr &envir) {
   obj::obj_ptr right = eval(prefix_node->right, envir);
+  return evalPrefixOperator(prefix_node->op, right);
+}
+
+obj::obj_ptr evalPrefixOperator(const Token &op, const obj::obj_ptr &right) {
   switch (op.get_type()) {
     case TokenType::MINUS: {
       if (right->_type() != obj::INTEGER) {
         throw NoSuchOperatorException("No such operation -(" +
                                       right->inspect() + ")");
       }
-      obj::int_ptr int_obj = std::dynamic_pointer_cast<obj::Integer>(right);
+      obj::int_ptr int_obj = fast_cast<obj::Integer>(right);
       return evalMinusOperator(int_obj);
     }
     case TokenType::BANG: {
@@ -327,33 +437,43 @@ obj::obj_ptr evalPrefix(ast::prefix_ptr prefix_node, env::env_ptr envir) {
   }
 }
 
-obj::obj_ptr evalAssign(ast::ident_ptr left, ast::node_ptr right,
-                        env::env_ptr envir) {
-  obj::obj_ptr value = eval(right, envir);
-  if (value->_type() != obj::ERROR) {
+obj::Value evalAssign(const ast::ident_ptr &left, const ast::node_ptr &right,
+                      const env::env_ptr &envir) {
+  obj::Value value = evalValue(right, envir);
+  if (!isError(value)) {
     // We will need to do some checks to make sure certain types are cloned so
     // that they aren't passed around by reference (int, float, bool, string).
     // This might be unnecessary if these "cloned" types are immutable simply by
     // having no method of changing them. However, it could still be safer to
     // clone explicitly, if a bit inefficient.
-    envir->set(left->value, value);
+    if (left->slot < 0) {
+      envir->set(left->symbol, value);
+    } else {
+      envir->set(left->depth, left->slot, left->symbol, value, left->shadows);
+    }
   }
   return value;
 }
 
-obj::obj_ptr evalIndexAssign(ast::index_ptr left, ast::node_ptr right,
-                             env::env_ptr envir) {
+obj::obj_ptr evalIndexAssign(const ast::index_ptr &left,
+                             const ast::node_ptr &right,
+                             const env::env_ptr &envir) {
   obj::obj_ptr left_obj = eval(left->left, envir);
   obj::obj_ptr index = eval(left->index, envir);
   obj::obj_ptr value = eval(right, envir);
+  return evalIndexAssignOperator(left_obj, index, value);
+}
 
+obj::obj_ptr evalIndexAssignOperator(const obj::obj_ptr &left_obj,
+                                     const obj::obj_ptr &index,
+                                     const obj::obj_ptr &value) {
   switch (left_obj->_type()) {
     case obj::LIST: {
-      obj::arr_ptr list_obj = std::dynamic_pointer_cast<obj::List>(left_obj);
+      obj::arr_ptr list_obj = fast_cast<obj::List>(left_obj);
       return indexList(list_obj, index, value);
     }
     case obj::MAP: {
-      obj::map_ptr map_obj = std::dynamic_pointer_cast<obj::Map>(left_obj);
+      obj::map_ptr map_obj = fast_cast<obj::Map>(left_obj);
       return indexMap(map_obj, index, value);
     }
     default: {
@@ -361,31 +481,33 @@ obj::obj_ptr evalIndexAssign(ast::index_ptr left, ast::node_ptr right,
                                     " cannot be indexed using []");
     }
   }
-
-  return value;
 }
 
-obj::obj_ptr evalIndex(ast::node_ptr left_expr, ast::node_ptr index_expr,
-                       env::env_ptr envir) {
+obj::obj_ptr evalIndex(const ast::node_ptr &left_expr,
+                       const ast::node_ptr &index_expr,
+                       const env::env_ptr &envir) {
   obj::obj_ptr left_obj = eval(left_expr, envir);
   obj::obj_ptr index_obj = eval(index_expr, envir);
+  return evalIndexOperator(left_obj, index_obj);
+}
 
+obj::obj_ptr evalIndexOperator(const obj::obj_ptr &left_obj,
+                               const obj::obj_ptr &index_obj) {
   switch (left_obj->_type()) {
     case obj::LIST: {
-      obj::arr_ptr list_obj = std::dynamic_pointer_cast<obj::List>(left_obj);
+      obj::arr_ptr list_obj = fast_cast<obj::List>(left_obj);
       return indexList(list_obj, index_obj);
     }
     case obj::STRING: {
-      obj::str_ptr str_obj = std::dynamic_pointer_cast<obj::String>(left_obj);
+      obj::str_ptr str_obj = fast_cast<obj::String>(left_obj);
       return indexString(str_obj, index_obj);
     }
     case obj::MAP: {
-      obj::map_ptr map_obj = std::dynamic_pointer_cast<obj::Map>(left_obj);
+      obj::map_ptr map_obj = fast_cast<obj::Map>(left_obj);
       return indexMap(map_obj, index_obj);
     }
     case obj::RANGE: {
-      obj::range_ptr range_obj =
-          std::dynamic_pointer_cast<obj::Range>(left_obj);
+      obj::range_ptr range_obj = fast_cast<obj::Range>(left_obj);
       return indexRange(range_obj, index_obj);
     }
     default: {
@@ -395,47 +517,53 @@ obj::obj_ptr evalIndex(ast::node_ptr left_expr, ast::node_ptr index_expr,
   }
 }
 
-obj::obj_ptr evalIntegerInfixOperator(Token op, obj::int_ptr left,
-                                      obj::int_ptr right) {
+obj::obj_ptr evalIntegerInfixOperator(const Token &op, const obj::int_ptr &left,
+                                      const obj::int_ptr &right) {
+  return evalIntegerInfixValue(op, left->value, right->value).box();
+}
+
+// The arithmetic itself works on raw numbers and gives back an unboxed value,
+// so the VM can use it without allocating anything. Only eval() boxes it.
+obj::Value evalIntegerInfixValue(const Token &op, int64_t left, int64_t right) {
   switch (op.get_type()) {
     case TokenType::PLUS: {
-      return obj::int_ptr(new obj::Integer(left->value + right->value));
+      return obj::Value::integer(left + right);
     }
     case TokenType::MINUS: {
-      return obj::int_ptr(new obj::Integer(left->value - right->value));
+      return obj::Value::integer(left - right);
     }
     case TokenType::ASTERISK: {
-      return obj::int_ptr(new obj::Integer(left->value * right->value));
+      return obj::Value::integer(left * right);
     }
     case TokenType::SLASH: {
-      if (right->value == 0) {
+      if (right == 0) {
         throw DivideByZeroException(op);
       }
-      return obj::int_ptr(new obj::Integer(left->value / right->value));
+      return obj::Value::integer(left / right);
     }
     case TokenType::MODULO: {
-      if (right->value == 0) {
+      if (right == 0) {
         throw DivideByZeroException(op);
       }
-      return obj::int_ptr(new obj::Integer(left->value % right->value));
+      return obj::Value::integer(left % right);
     }
     case TokenType::EQ: {
-      return nativeBoolToObject(left->value == right->value);
+      return obj::Value::boolean(left == right);
     }
     case TokenType::NEQ: {
-      return nativeBoolToObject(left->value != right->value);
+      return obj::Value::boolean(left != right);
     }
     case TokenType::LT: {
-      return nativeBoolToObject(left->value < right->value);
+      return obj::Value::boolean(left < right);
     }
     case TokenType::GT: {
-      return nativeBoolToObject(left->value > right->value);
+      return obj::Value::boolean(left > right);
     }
     case TokenType::LTEQ: {
-      return nativeBoolToObject(left->value <= right->value);
+      return obj::Value::boolean(left <= right);
     }
     case TokenType::GTEQ: {
-      return nativeBoolToObject(left->value >= right->value);
+      return obj::Value::boolean(left >= right);
     }
     default: {
       throw NoSuchOperatorException("No such operation INT " +
@@ -444,8 +572,8 @@ obj::obj_ptr evalIntegerInfixOperator(Token op, obj::int_ptr left,
   }
 }
 
-obj::obj_ptr evalBoolInfixOperator(Token op, obj::bool_ptr left,
-                                   obj::bool_ptr right) {
+obj::obj_ptr evalBoolInfixOperator(const Token &op, const obj::bool_ptr &left,
+                                   const obj::bool_ptr &right) {
   switch (op.get_type()) {
     case TokenType::EQ: {
       return nativeBoolToObject(left->value == right->value);
@@ -466,19 +594,19 @@ obj::obj_ptr evalBoolInfixOperator(Token op, obj::bool_ptr left,
   }
 }
 
-obj::obj_ptr evalStringInfixOperator(Token op, obj::str_ptr left,
-                                     obj::str_ptr right) {
+obj::obj_ptr evalStringInfixOperator(const Token &op, const obj::str_ptr &left,
+                                     const obj::str_ptr &right) {
   switch (op.get_type()) {
     case TokenType::EQ: {
-      return nativeBoolToObject(left->value == right->value);
+      return nativeBoolToObject(left->size() == right->size() &&
+                                left->get_value() == right->get_value());
     } break;
     case TokenType::NEQ: {
-      return nativeBoolToObject(left->value != right->value);
+      return nativeBoolToObject(left->size() != right->size() ||
+                                left->get_value() != right->get_value());
     } break;
     case TokenType::PLUS: {
-      std::string new_string = left->value + right->value;
-      std::cout << new_string << "\n";
-      return obj::str_ptr(new obj::String(new_string));
+      return obj::String::concat(left, right);
     } break;
     default: {
       throw NoSuchOperatorException("No such operator STRING " +
@@ -487,8 +615,8 @@ obj::obj_ptr evalStringInfixOperator(Token op, obj::str_ptr left,
   }
 }
 
-obj::obj_ptr evalListInfixOperator(Token op, obj::arr_ptr left,
-                                   obj::arr_ptr right) {
+obj::obj_ptr evalListInfixOperator(const Token &op, const obj::arr_ptr &left,
+                                   const obj::arr_ptr &right) {
   switch (op.get_type()) {
     case TokenType::EQ: {
       return nativeBoolToObject(left == right);
@@ -503,7 +631,7 @@ obj::obj_ptr evalListInfixOperator(Token op, obj::arr_ptr left,
                           left->values.end());
       new_obj_list.insert(new_obj_list.end(), right->values.begin(),
                           right->values.end());
-      return obj::arr_ptr(new obj::List(new_obj_list));
+      return pool::make<obj::List>(new_obj_list);
     } break;
     default: {
       throw NoSuchOperatorException("No such operator LIST " +
@@ -512,8 +640,8 @@ obj::obj_ptr evalListInfixOperator(Token op, obj::arr_ptr left,
   }
 }
 
-obj::obj_ptr evalRangeInfixOperator(Token op, obj::obj_ptr left,
-                                    obj::obj_ptr right) {
+obj::obj_ptr evalRangeInfixOperator(const Token &op, const obj::obj_ptr &left,
+                                    const obj::obj_ptr &right) {
   // Doing validation here to keep the evalInfix function a little cleaner
   if (left->_type() != obj::INTEGER || right->_type() != obj::INTEGER) {
     throw InvalidArgsException("Range expression expects int types, received " +
@@ -521,30 +649,30 @@ obj::obj_ptr evalRangeInfixOperator(Token op, obj::obj_ptr left,
                                obj::type_to_string(right->_type()));
   }
 
-  obj::int_ptr start = std::dynamic_pointer_cast<obj::Integer>(left);
-  obj::int_ptr end = std::dynamic_pointer_cast<obj::Integer>(right);
+  int64_t start = fast_cast<obj::Integer>(left)->value;
+  int64_t end = fast_cast<obj::Integer>(right)->value;
 
   // Triple-dot range means it excludes the end integer, and only includes up to
   // the integer before the end. For a backwards range, we gotta add to the end
   // value rather than subtract. The exception is if the start and end are the
   // same, in which case it's always a range of 1. These decisions may seem
   // arbitrary, and that's because they kinda are.
-  if (op.get_type() == TokenType::TRIPLE_DOT && start->value != end->value) {
+  if (op.get_type() == TokenType::TRIPLE_DOT && start != end) {
     int8_t mod = 1;
-    if (start->value < end->value) {
+    if (start < end) {
       mod *= -1;
     }
-    end = obj::int_ptr(new obj::Integer(end->value + mod));
+    end += mod;
   }
 
-  return obj::range_ptr(new obj::Range(start, end));
+  return pool::make<obj::Range>(start, end);
 }
 
-obj::obj_ptr evalMinusOperator(obj::int_ptr num) {
-  return obj::int_ptr(new obj::Integer(-1 * num->value));
+obj::obj_ptr evalMinusOperator(const obj::int_ptr &num) {
+  return obj::make_integer(-1 * num->value);
 }
 
-obj::obj_ptr evalBangOperator(obj::obj_ptr input) {
+obj::obj_ptr evalBangOperator(const obj::obj_ptr &input) {
   // obj::bool_ptr init_val = truthiness(input);
   return truthiness(input, true);
 }
@@ -558,15 +686,16 @@ obj::obj_ptr evalBangOperator(obj::obj_ptr input) {
  * an optional (or a NONE is returned if there is no default), including other
  * optionals. This may change in the future.
  */
-obj::obj_ptr evalIfElse(ast::ifelse_ptr ifelse_node, env::env_ptr envir) {
+obj::obj_ptr evalIfElse(const ast::ifelse_ptr &ifelse_node,
+                        const env::env_ptr &envir) {
   std::vector<ast::condition_set>::iterator set;
   for (set = ifelse_node->list.begin(); set != ifelse_node->list.end(); set++) {
     bool execute_block = false;
     if (set->condition == NULL) {
       execute_block = true;
     } else {
-      obj::obj_ptr condition = eval(set->condition, envir);
-      execute_block = truthiness(condition, false) == TRUE_OBJ;
+      obj::Value condition = evalValue(set->condition, envir);
+      execute_block = valueTruthiness(condition);
     }
 
     if (execute_block) {
@@ -580,7 +709,7 @@ obj::obj_ptr evalIfElse(ast::ifelse_ptr ifelse_node, env::env_ptr envir) {
       if (consequence->_type() == obj::RETURN_VAL) {
         return consequence;
       }
-      return obj::opt_ptr(new obj::Option(consequence));
+      return pool::make<obj::Option>(consequence);
     }
   }
   return NONE_OBJ;
@@ -606,35 +735,35 @@ obj::obj_ptr evalIfElse(ast::ifelse_ptr ifelse_node, env::env_ptr envir) {
 // falsy. That seems like a useful shortcut. A range with the same start and end
 // is considered truthy.
 
-obj::bool_ptr truthiness(obj::obj_ptr input, bool negate) {
+obj::bool_ptr truthiness(const obj::obj_ptr &input, bool negate) {
   bool new_val = false;
   switch (input->_type()) {
     case obj::BOOLEAN: {
       new_val = input == TRUE_OBJ;
     } break;
     case obj::INTEGER: {
-      obj::int_ptr int_obj = std::dynamic_pointer_cast<obj::Integer>(input);
+      obj::int_ptr int_obj = fast_cast<obj::Integer>(input);
       new_val = int_obj->value != 0;
     } break;
     case obj::STRING: {
-      obj::str_ptr str_obj = std::dynamic_pointer_cast<obj::String>(input);
-      new_val = str_obj->value != "";
+      obj::str_ptr str_obj = fast_cast<obj::String>(input);
+      new_val = str_obj->size() != 0;
     } break;
     case obj::LIST: {
-      obj::arr_ptr arr_obj = std::dynamic_pointer_cast<obj::List>(input);
+      obj::arr_ptr arr_obj = fast_cast<obj::List>(input);
       new_val = arr_obj->values.size() != 0;
     } break;
     case obj::MAP: {
-      obj::map_ptr map_obj = std::dynamic_pointer_cast<obj::Map>(input);
+      obj::map_ptr map_obj = fast_cast<obj::Map>(input);
       // Hoping this works, I'll have to test this
       new_val = map_obj->pairs.size() != 0;
     } break;
     case obj::OPTION: {
-      obj::opt_ptr opt_obj = std::dynamic_pointer_cast<obj::Option>(input);
+      obj::opt_ptr opt_obj = fast_cast<obj::Option>(input);
       new_val = opt_obj->value != nullptr;
     } break;
     case obj::RANGE: {
-      obj::range_ptr range_obj = std::dynamic_pointer_cast<obj::Range>(input);
+      obj::range_ptr range_obj = fast_cast<obj::Range>(input);
       new_val = range_obj->forward();
     } break;
     default: {}
@@ -642,77 +771,147 @@ obj::bool_ptr truthiness(obj::obj_ptr input, bool negate) {
   return nativeBoolToObject(new_val ^ negate);
 }
 
+// Same rules as above, but numbers, bools and none are checked without ever
+// being boxed
+bool valueTruthiness(const obj::Value &input) {
+  if (input.is_int()) {
+    return input.as_int() != 0;
+  }
+  if (input.is_bool()) {
+    return input.as_bool();
+  }
+  if (input.is_none()) {
+    return false;
+  }
+  return truthiness(input.box())->value;
+}
+
+bool isError(const obj::Value &value) {
+  return value.is_object() && value.object()->_type() == obj::ERROR;
+}
+
 obj::bool_ptr nativeBoolToObject(bool val) {
   return val ? TRUE_OBJ : FALSE_OBJ;
 }
 
-obj::obj_list evalExpressionList(ast::node_list exprs, env::env_ptr envir) {
+obj::obj_list evalExpressionList(const ast::node_list &exprs,
+                                 const env::env_ptr &envir) {
   obj::obj_list values;
-  ast::node_list::iterator cur_node;
+  values.reserve(exprs.size());
+  ast::node_list::const_iterator cur_node;
   for (cur_node = exprs.begin(); cur_node != exprs.end(); cur_node++) {
     values.push_back(eval(*cur_node, envir));
   }
   return values;
 }
 
-obj::obj_ptr applyFunction(obj::obj_ptr callable, obj::obj_list args) {
-  if (callable->_type() == obj::BUILTIN) {
-    obj::builtin_ptr builtin =
-        std::dynamic_pointer_cast<obj::Builtin>(callable);
-    return builtin->fn(args);
-  }
-
-  // If not a builtin, can only be a regular function
-  obj::func_ptr func_obj = std::dynamic_pointer_cast<obj::Function>(callable);
-  ast::param_list params = func_obj->func_node->params;
+// The environment a call to the function runs in, which encloses the
+// function's own environment and holds its arguments
+env::env_ptr callEnvironment(const obj::func_ptr &func_obj, size_t arg_count) {
   // Providing too many arguments is fine, since additional ones can just be
   // ignored. However, too few arguments will always be wrong, so it's an error
-  if (params.size() > args.size()) {
+  if (func_obj->func_node->params.size() > arg_count) {
     throw InvalidArgsException("Incorrect number of args given");
   }
+  return pool::make<env::Environment>(
+      func_obj->envir, func_obj->func_node->body->slot_count);
+}
+
+obj::obj_ptr runFunction(const obj::func_ptr &func_obj,
+                         const env::env_ptr &new_env) {
+  // Functions created by the VM carry their compiled body with them, so they
+  // keep running as bytecode no matter who calls them (builtins included)
+  if (func_obj->proto != nullptr) {
+    return vm::execute(*func_obj->proto, new_env);
+  }
+
+  obj::obj_ptr result = eval(func_obj->func_node->body, new_env);
+  return unwrapReturn(result);
+}
 
-  // This new environment encloses the function's environment, providing
-  // temporary access to the new argument variables
-  env::env_ptr new_env = env::env_ptr(new env::Environment(func_obj->envir));
+obj::obj_ptr applyFunction(const obj::obj_ptr &callable, obj::obj_list args) {
+  if (callable->_type() == obj::BUILTIN) {
+    obj::builtin_ptr builtin = fast_cast<obj::Builtin>(callable);
+    PROFILE_CALL(*builtin);
+    sample::FrameGuard frame(*builtin);
+    return builtin->fn(args);
+  }
 
-  // Filling the new environment with happy argument values.
-  ast::param_list::iterator param;
+  // If not a builtin, can only be a regular function
+  obj::func_ptr func_obj = fast_cast<obj::Function>(callable);
+  PROFILE_CALL(*func_obj->func_node);
+  sample::FrameGuard frame(*func_obj->func_node);
+  env::env_ptr new_env = callEnvironment(func_obj, args.size());
+
+  // Filling the new environment with happy argument values. The args are ours
+  // (callers hand them over), so they're moved in rather than copied.
+  const ast::param_list &params = func_obj->func_node->params;
+  ast::param_list::const_iterator param;
   obj::obj_list::iterator arg_value;
   for (param = params.begin(), arg_value = args.begin(); param != params.end();
        param++, arg_value++) {
     // Man, these pointers are starting to get confusing.
-    new_env->init((*param)->value, (*arg_value));
+    bindIdent(*param, std::move(*arg_value), new_env);
   }
 
-  obj::obj_ptr result = eval(func_obj->func_node->body, new_env);
-  return unwrapReturn(result);
+  return runFunction(func_obj, new_env);
 }
 
-obj::obj_ptr unwrapReturn(obj::obj_ptr val) {
+obj::obj_ptr applyFunction(const obj::obj_ptr &callable,
+                           const obj::value_list &args) {
+  if (callable->_type() == obj::BUILTIN) {
+    obj::builtin_ptr builtin = fast_cast<obj::Builtin>(callable);
+    PROFILE_CALL(*builtin);
+    sample::FrameGuard frame(*builtin);
+    obj::obj_list boxed;
+    boxed.reserve(args.size());
+    for (const obj::Value &arg : args) {
+      boxed.push_back(arg.box());
+    }
+    return builtin->fn(boxed);
+  }
+
+  obj::func_ptr func_obj = fast_cast<obj::Function>(callable);
+  PROFILE_CALL(*func_obj->func_node);
+  sample::FrameGuard frame(*func_obj->func_node);
+  env::env_ptr new_env = callEnvironment(func_obj, args.size());
+
+  // Only as many args as there are params get bound, so an argument the
+  // function doesn't take is never boxed at all
+  const ast::param_list &params = func_obj->func_node->params;
+  for (size_t i = 0; i < params.size(); i++) {
+    bindIdent(params[i], args[i], new_env);
+  }
+
+  return runFunction(func_obj, new_env);
+}
+
+obj::obj_ptr unwrapReturn(const obj::obj_ptr &val) {
   if (val->_type() == obj::RETURN_VAL) {
-    obj::return_ptr return_obj = std::dynamic_pointer_cast<obj::ReturnVal>(val);
+    obj::return_ptr return_obj = fast_cast<obj::ReturnVal>(val);
     return return_obj->value;
   }
   return val;
 }
 
-obj::obj_ptr indexList(obj::arr_ptr list, obj::obj_ptr index,
-                       obj::obj_ptr value) {
+obj::obj_ptr indexList(const obj::arr_ptr &list, const obj::obj_ptr &index,
+                       const obj::obj_ptr &value) {
   switch (index->_type()) {
     case obj::INTEGER: {
-      obj::int_ptr int_obj = std::dynamic_pointer_cast<obj::Integer>(index);
+      obj::int_ptr int_obj = fast_cast<obj::Integer>(index);
       int64_t ind = int_obj->value;
       if (ind < 0 || static_cast<uint64_t>(ind) >= list->values.size()) {
         return NONE_OBJ;
       }
 
       // Return value if not an assignment
-      if (value != nullptr) {
-        return list->values.at(ind);
+      if (value == nullptr) {
+        return list->values[ind];
       }
 
       // Set list value at index and return passed value if assignment
-      list->values.assign(ind, value);
+      list->values[ind] = value;
+      list->touch();
       return value;
     } break;
     // case obj::FUNCTION: {
@@ -726,15 +925,15 @@ obj::obj_ptr indexList(obj::arr_ptr list, obj::obj_ptr index,
   }
 }
 
-obj::obj_ptr indexString(obj::str_ptr str, obj::obj_ptr index) {
+obj::obj_ptr indexString(const obj::str_ptr &str, const obj::obj_ptr &index) {
   switch (index->_type()) {
     case obj::INTEGER: {
-      obj::int_ptr int_obj = std::dynamic_pointer_cast<obj::Integer>(index);
+      obj::int_ptr int_obj = fast_cast<obj::Integer>(index);
       int64_t val = int_obj->value;
-      if (val < 0 || static_cast<uint64_t>(val) >= str->value.size()) {
-        return obj::str_ptr(new obj::String(""));
+      if (val < 0 || static_cast<uint64_t>(val) >= str->size()) {
+        return pool::make<obj::String>("");
       }
-      return obj::str_ptr(new obj::String(str->value.substr(val, 1)));
+      return obj::make_char(str->get_value()[val]);
     } break;
     // case obj::FUNCTION: {
     //   // TODO: When 'map' builtin is written, use that here
@@ -747,40 +946,34 @@ obj::obj_ptr indexString(obj::str_ptr str, obj::obj_ptr index) {
   }
 }
 
-obj::obj_ptr indexMap(obj::map_ptr map, obj::obj_ptr index,
-                      obj::obj_ptr value) {
-  uint64_t key_hash = index->hash();
-
-  bool has_key = map->pairs.count(key_hash) > 0;
-
+obj::obj_ptr indexMap(const obj::map_ptr &map, const obj::obj_ptr &index,
+                      const obj::obj_ptr &value) {
   if (value == nullptr) {
-    if (map->pairs.size() == 0 || !has_key) {
+    const obj::obj_ptr *found = map->pairs.find(index);
+    if (found == nullptr) {
       return NONE_OBJ;
     }
-
-    const obj::obj_pair kv = (map->pairs).at(key_hash);
-    return kv.second;
+    return *found;
   }
 
-  obj::obj_pair new_kv_pair;
-  new_kv_pair.first = index;
-  new_kv_pair.second = value;
-
-  (map->pairs).at(key_hash) = new_kv_pair;
+  // Assigning to a key that isn't there yet adds it
+  insertMapPair(map->pairs, index, value);
+  map->touch();
   return value;
 }
 
-obj::obj_ptr indexRange(obj::range_ptr range, obj::obj_ptr index) {
+obj::obj_ptr indexRange(const obj::range_ptr &range,
+                        const obj::obj_ptr &index) {
   switch (index->_type()) {
     case obj::INTEGER: {
-      obj::int_ptr int_obj = std::dynamic_pointer_cast<obj::Integer>(index);
+      obj::int_ptr int_obj = fast_cast<obj::Integer>(index);
       int64_t key = int_obj->value;
       if (!range->forward()) {
         key *= -1;
       }
-      int64_t potential_value = range->start->value + key;
+      int64_t potential_value = range->start + key;
       if (range->between(potential_value)) {
-        return obj::int_ptr(new obj::Integer(potential_value));
+        return obj::make_integer(potential_value);
       }
 
       return NONE_OBJ;
@@ -0,0 +1,202 @@
+#include "interpreter.h"
+#include <unordered_set>
+#include "compiler.h"
+#include "eval.h"
+#include "lexer.h"
+#include "parser.h"
+#include "vm.h"
+
+/***************/
+/*** Program ***/
+/***************/
+
+program_ptr Program::compile(std::string_view source, bool use_vm) {
+  std::shared_ptr<Program> program(new Program());
+  {
+    // The tree doesn't point into the source (see token.h), so the source
+    // only has to last until it's parsed
+    Lexer lexer = Lexer(source);
+    Parser parser = Parser(&lexer);
+    program->tree = parser.parse_program();
+  }
+  if (use_vm) {
+    vm::Compiler compiler = vm::Compiler();
+    program->proto = compiler.compile_program(program->tree);
+  }
+  return program;
+}
+
+/*******************/
+/*** Interpreter ***/
+/*******************/
+
+namespace {
+
+// Whether the program left a value as the host gave it
+bool untouched(const obj::Value &now, const obj::Value &given) {
+  if (now.is_object() || given.is_object()) {
+    return now.object() == given.object();
+  }
+  return now.type() == given.type() && now.as_int() == given.as_int();
+}
+
+// Clears out everything but the inputs the program didn't reassign. Those were
+// made outside the scope, so unlike the program's own variables they can't be
+// holding on to it.
+void forget_declared(env::Environment &scope, const bindings &inputs) {
+  scope.slots.clear();
+  for (auto var = scope.store.begin(); var != scope.store.end();) {
+    auto input = inputs.find(std::string(SymbolTable::name(var->first)));
+    if (input != inputs.end() && untouched(var->second, input->second)) {
+      var++;
+    } else {
+      var = scope.store.erase(var);
+    }
+  }
+}
+
+// Whether anything reachable from the object (a function in it, the
+// variables that function can see, what those hold, and so on) has the scope
+// in its reach. Walked with a stack and a list of what's been seen, since
+// closures and the scopes they hold make cycles.
+bool reaches(const obj::obj_ptr &root, const env::Environment *scope) {
+  std::vector<obj::obj_ptr> objects;
+  std::vector<env::Environment *> envs;
+  std::unordered_set<const void *> seen;
+
+  auto visit = [&](const obj::Value &value) {
+    if (value.is_object() && seen.insert(value.object().get()).second) {
+      objects.push_back(value.object());
+    }
+  };
+  auto enter = [&](const env::env_ptr &envir) {
+    if (envir != nullptr && seen.insert(envir.get()).second) {
+      envs.push_back(envir.get());
+    }
+  };
+
+  visit(obj::Value(root));
+  while (!objects.empty() || !envs.empty()) {
+    if (!envs.empty()) {
+      env::Environment *envir = envs.back();
+      envs.pop_back();
+      if (envir == scope) {
+        return true;
+      }
+      for (const obj::Value &value : envir->slots) {
+        visit(value);
+      }
+      for (const auto &var : envir->store) {
+        visit(var.second);
+      }
+      enter(envir->outer);
+      continue;
+    }
+
+    obj::obj_ptr object = std::move(objects.back());
+    objects.pop_back();
+    switch (object->_type()) {
+      case obj::FUNCTION:
+        enter(fast_cast<obj::Function>(object)->envir);
+        break;
+      case obj::LIST:
+        for (const obj::obj_ptr &element :
+             fast_cast<obj::List>(object)->values) {
+          visit(obj::Value(element));
+        }
+        break;
+      case obj::MAP:
+        for (const auto &entry : fast_cast<obj::Map>(object)->pairs) {
+          visit(obj::Value(entry.key));
+          visit(obj::Value(entry.value));
+        }
+        break;
+      case obj::OPTION:
+        visit(obj::Value(fast_cast<obj::Option>(object)->value));
+        break;
+      default:
+        break;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+Interpreter::Interpreter() : envir(pool::make<env::Environment>()) {}
+
+obj::obj_ptr Interpreter::run(std::string_view source) {
+  return run(Program::compile(source));
+}
+
+obj::obj_ptr Interpreter::run(const program_ptr &program) {
+  return run_in(*program, envir);
+}
+
+obj::obj_ptr Interpreter::execute(const program_ptr &program,
+                                  const bindings &inputs) {
+  env::env_ptr scope;
+  if (spare_scopes.empty()) {
+    scope = pool::make<env::Environment>(envir);
+  } else {
+    scope = std::move(spare_scopes.back());
+    spare_scopes.pop_back();
+  }
+  for (const auto &input : inputs) {
+    scope->init(input.first, input.second);
+  }
+
+  // Whatever the program declared is let go of, whether it finished or threw.
+  // A function declared at the top holds the scope, and the scope holds the
+  // function, so neither would ever be freed otherwise.
+  //
+  // Unless what the program gave back can still reach the scope (a function
+  // it returned, say), in which case the scope is left just as the program
+  // left it, for that function to use.
+  bool still_held = false;
+  struct Emptied {
+    const env::env_ptr &scope;
+    const bindings &inputs;
+    const bool &kept;
+    ~Emptied() {
+      if (!kept) {
+        forget_declared(*scope, inputs);
+      }
+    }
+  };
+
+  obj::obj_ptr result;
+  {
+    Emptied emptied{scope, inputs, still_held};
+    result = run_in(*program, scope);
+    still_held = result != nullptr && reaches(result, scope.get());
+  }
+
+  // Handing the scope out again would change what a function holding it sees
+  if (!still_held && scope.use_count() == 1) {
+    scope->store.clear();
+    spare_scopes.push_back(std::move(scope));
+  }
+  return result;
+}
+
+void Interpreter::bind(const std::string &name, obj::Value value) {
+  symbol_id key = SymbolTable::intern(name);
+  auto found = envir->store.find(key);
+  if (found != envir->store.end()) {
+    found->second = std::move(value);
+  } else {
+    envir->init(key, std::move(value));
+  }
+}
+
+obj::obj_ptr Interpreter::run_in(const Program &program,
+                                 const env::env_ptr &scope) {
+  // The host may have moved this interpreter (or the values it binds) over
+  // from another thread since the last run
+  obj::forget_nested_hashes();
+  if (program.proto != nullptr) {
+    return vm::execute(*program.proto, scope);
+  }
+  return eval(program.tree, scope);
+}
@@ -1,6 +1,6 @@
 #include "lexer.h"
 
-Lexer::Lexer(const std::string &_input) {
+Lexer::Lexer(std::string_view _input) {
   input = _input;
   position = 0;
   read_position = 0;
@@ -15,7 +15,11 @@ Lexer::Lexer(const std::string &_input) {
 Token Lexer::next_token() {
   // These defaults mean that these values need to be overwritten
   TokenType tok = TokenType::ILLEGAL;
-  std::string lit = "ILLEGAL";
+  std::string_view lit = "ILLEGAL";
+  // Only names get interned. Operators and keywords have fixed text, and
+  // numbers and strings are left pointing into the input until the parser
+  // copies them into the tree.
+  bool interned = false;
   uint col = cur_column;
   uint line = cur_line;
 
@@ -107,7 +111,7 @@ Token Lexer::next_token() {
         lit = "!=";
       } else {
         tok = TokenType::BANG;
-        lit = '!';
+        lit = "!";
       }
       break;
     case '<':
@@ -183,7 +187,7 @@ Token Lexer::next_token() {
 
     // Strings
     case '"': {
-      std::string str = "";
+      std::string_view str;
       bool ok = read_string(str);
       if (ok) {
         tok = TokenType::STRING;
@@ -199,11 +203,17 @@ Token Lexer::next_token() {
     default:
       if (isLetter(ch)) {
         lit = read_ident();
-        tok = Token::lookup_ident(lit);
+        std::string_view keyword;
+        tok = Token::lookup_ident(lit, &keyword);
         if (tok == TokenType::OPTION) {
           // Strip the `?`
           lit = lit.substr(0, lit.length() - 1);
         }
+        if (tok == TokenType::IDENT || tok == TokenType::OPTION) {
+          interned = true;
+        } else {
+          lit = keyword;
+        }
       } else if (isDigit(ch)) {
         lit = read_num();
         tok = TokenType::INT;
@@ -215,7 +225,10 @@ Token Lexer::next_token() {
   }
 
   read_char();
-  return Token(tok, lit, col, line);
+  if (interned) {
+    return Token(tok, lit, col, line);
+  }
+  return Token::fixed(tok, lit, col, line);
 }
 
 char Lexer::peak_char() {
@@ -247,7 +260,7 @@ void Lexer::skip_whitespace() {
   }
 }
 
-std::string Lexer::read_num() {
+std::string_view Lexer::read_num() {
   uint pos = position;
   uint size = 1;
 
@@ -258,7 +271,7 @@ std::string Lexer::read_num() {
   return input.substr(pos, size);
 }
 
-std::string Lexer::read_ident() {
+std::string_view Lexer::read_ident() {
   uint pos = position;
   uint size = 1;
 
@@ -276,7 +289,7 @@ std::string Lexer::read_ident() {
 
 // Returns whether we get a good string or not. If so, then str is set to the
 // lexed string value
-bool Lexer::read_string(std::string &str) {
+bool Lexer::read_string(std::string_view &str) {
   uint pos = position + 1;
   uint size = 0;
 
@@ -1,60 +1,219 @@
-
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+#include <cstring>
+#include <fstream>
 #include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+#include "alloc_stats.h"
 #include "ast.h"
+#include "compiler.h"
 #include "environment.h"
 #include "eval.h"
 #include "lexer.h"
 #include "object.h"
 #include "parser.h"
-
-int main() {
-  std::string input = R"INPUT(
-print("int:", 1)
-
-print("bool:", false)
-
-print("string")
-
-print("list:", [0, 1, 2])
-
-let m = {
-  foo: "bar",
-  baz: "flu"
+#include "profile.h"
+#include "sampler.h"
+#include "source.h"
+#include "vm.h"
+
+namespace {
+
+const char *USAGE =
+    "Usage: parth [options] <script>\n"
+    "\n"
+    "Options:\n"
+    "  --vm     Run on the bytecode VM instead of the tree-walking evaluator\n"
+    "  --time   Print how long each phase took\n"
+    "  --stats  Print how many allocations each phase made, then how many\n"
+    "           objects and environments of each kind were made and freed\n"
+    "  --profile\n"
+    "           Print where eval spent its time, by node type and by call\n"
+    "  --profile-stacks=<file>\n"
+    "           Write the time by call stack to the file, for flamegraph.pl\n"
+    "  --sample=<file>\n"
+    "           Sample the call stack as the script runs and write the\n"
+    "           samples to the file as folded stacks, with line numbers\n"
+    "  --sample-hz=<n>\n"
+    "           How many samples to take per second of CPU time (100)\n"
+    "  --help   Print this message\n"
+    "\n"
+    "The profiling options need parth built with `make PROFILE=1`. Sampling\n"
+    "works in any build.\n";
+
+struct Options {
+  bool use_vm = false;
+  bool time = false;
+  bool stats = false;
+  bool profile = false;
+  std::string stacks_path;
+  std::string sample_path;
+  int sample_hz = 100;
+  std::string path;
+};
+
+// A phase of running a script, measured only if it was asked for
+struct Phase {
+  std::string name;
+  std::chrono::steady_clock::duration elapsed;
+  stats::Allocations allocations;
+};
+
+// Runs one phase of the script, noting its time and allocations on the way
+template <typename F>
+void measure(std::vector<Phase> &phases, const std::string &name, F f) {
+  stats::Allocations allocs_before = stats::allocations();
+  auto start = std::chrono::steady_clock::now();
+  f();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+  phases.push_back(Phase{name, elapsed, stats::allocations() - allocs_before});
 }
-print("map:", m)
 
-let f = (a, b) => {
-  c = a * a
-  c + b
+void report(const Options &opts, const std::vector<Phase> &phases) {
+  for (const Phase &phase : phases) {
+    std::cerr << phase.name << ":";
+    if (opts.time) {
+      double ms =
+          std::chrono::duration<double, std::milli>(phase.elapsed).count();
+      std::cerr << " " << ms << " ms";
+    }
+    if (opts.stats) {
+      std::cerr << (opts.time ? ", " : " ") << phase.allocations.to_string();
+    }
+    std::cerr << "\n";
+  }
 }
-print("func:", f)
-
-let havent?
-print("none:", havent)
-
-let have? = 9
-print("opt:", have)
 
-let r1 = (3 .. 9)
-print("range 1:", r1)
-
-let r2 = 4...10
-print("range 2:", r2)
-
-let r3 = 12..3
-print("range 3:", r3)
-
-let r4 = 11...5
-print("range 4:", r4)
-)INPUT";
-
-  Lexer l = Lexer(input);
-  Parser p = Parser(&l);
-  ast::block_ptr program = p.parse_program();
-  // std::cout << program->to_string() << std::endl;
-  env::env_ptr envir = env::env_ptr(new env::Environment());
-
-  obj::obj_ptr end = eval(program, envir);
+// Returns false if the arguments are no good, in which case the usage should
+// be shown
+bool parse_args(int argc, char **argv, Options &opts) {
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "--vm") == 0) {
+      opts.use_vm = true;
+    } else if (std::strcmp(argv[i], "--time") == 0) {
+      opts.time = true;
+    } else if (std::strcmp(argv[i], "--stats") == 0) {
+      opts.stats = true;
+    } else if (std::strcmp(argv[i], "--profile") == 0) {
+      opts.profile = true;
+    } else if (std::strncmp(argv[i], "--profile-stacks=", 17) == 0) {
+      opts.stacks_path = argv[i] + 17;
+    } else if (std::strncmp(argv[i], "--sample=", 9) == 0) {
+      opts.sample_path = argv[i] + 9;
+    } else if (std::strncmp(argv[i], "--sample-hz=", 12) == 0) {
+      opts.sample_hz = std::atoi(argv[i] + 12);
+      if (opts.sample_hz <= 0) {
+        return false;
+      }
+    } else if (argv[i][0] == '-' && argv[i][1] != '\0') {
+      return false;
+    } else if (opts.path.empty()) {
+      opts.path = argv[i];
+    } else {
+      return false;
+    }
+  }
+  return !opts.path.empty();
+}
 
-  std::cout << "Result: " << end->inspect() << std::endl;
-}
\ No newline at end of file
+}  // namespace
+
+int main(int argc, char **argv) {
+  Options opts;
+  if (!parse_args(argc, argv, opts)) {
+    std::cerr << USAGE;
+    bool asked = argc == 2 && std::strcmp(argv[1], "--help") == 0;
+    return asked ? 0 : 1;
+  }
+
+  if ((opts.profile || !opts.stacks_path.empty()) && !prof::ENABLED) {
+    std::cerr << "Error: parth was built without profiling, rebuild it with "
+                 "`make PROFILE=1`\n";
+    return 1;
+  }
+
+  std::vector<Phase> phases;
+  obj::obj_ptr end;
+  try {
+    ast::block_ptr program;
+    {
+      SourceFile source = SourceFile(opts.path);
+
+      // The parser pulls tokens from the lexer as it goes, so lexing can only
+      // be measured on its own by lexing the script once more, and parsing is
+      // reported without that share. The extra pass comes after parsing, so
+      // that both times the names are already interned, or not, the same way.
+      // Interning them is counted as part of parsing.
+      measure(phases, "parse", [&] {
+        Lexer lexer = Lexer(source.text());
+        Parser parser = Parser(&lexer);
+        program = parser.parse_program();
+      });
+      if (opts.time || opts.stats) {
+        measure(phases, "lex", [&] {
+          Lexer lexer = Lexer(source.text());
+          while (lexer.next_token().get_type() != TokenType::EOF_VAL) {
+          }
+        });
+        Phase &parse = phases[0];
+        const Phase &lex = phases[1];
+        parse.elapsed -= std::min(lex.elapsed, parse.elapsed);
+        parse.allocations = parse.allocations - lex.allocations;
+        // Still shown in the order they'd happen
+        std::swap(phases[0], phases[1]);
+      }
+      // The source is unmapped here. The AST doesn't need it.
+    }
+
+    env::env_ptr envir = pool::make<env::Environment>();
+    // Only running the script is sampled. Lexing and parsing have no Parth
+    // stack to show.
+    if (!opts.sample_path.empty()) {
+      sample::start(opts.sample_hz);
+    }
+    if (opts.use_vm) {
+      vm::proto_ptr proto;
+      measure(phases, "compile", [&] {
+        vm::Compiler compiler = vm::Compiler();
+        proto = compiler.compile_program(program);
+      });
+      measure(phases, "run", [&] { end = vm::execute(*proto, envir); });
+    } else {
+      measure(phases, "eval", [&] { end = eval(program, envir); });
+    }
+  } catch (const std::exception &e) {
+    sample::stop();
+    std::cerr << "Error: " << e.what() << "\n";
+    return 1;
+  }
+  sample::stop();
+
+  if (opts.time || opts.stats) {
+    report(opts, phases);
+  }
+  if (opts.stats) {
+    std::cerr << "\n" << stats::objects_report();
+  }
+  if (opts.profile) {
+    prof::report_flat(std::cerr);
+  }
+  if (!opts.stacks_path.empty()) {
+    std::ofstream stacks(opts.stacks_path);
+    prof::report_collapsed(stacks);
+  }
+  if (!opts.sample_path.empty()) {
+    std::ofstream samples(opts.sample_path);
+    sample::write_folded(samples);
+    if (sample::dropped() > 0) {
+      std::cerr << "Warning: " << sample::dropped()
+                << " samples didn't fit and were dropped\n";
+    }
+  }
+  if (end != nullptr) {
+    std::cout << "Result: " << end->inspect() << std::endl;
+  }
+  return 0;
+}
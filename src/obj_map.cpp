@@ -0,0 +1,83 @@
+#include "obj_map.h"
+#include <algorithm>
+#include "object.h"
+
+namespace {
+
+// Smallest power of two that indexes n entries without going over 2/3 full
+size_t index_size_for(size_t n) {
+  size_t size = 1;
+  while (size * 2 < n * 3) {
+    size <<= 1;
+  }
+  return size;
+}
+
+}  // namespace
+
+obj::ObjMap::ObjMap() {}
+
+void obj::ObjMap::reserve(size_t n) {
+  entries.reserve(n);
+  size_t size = index_size_for(n);
+  if (size > index.size()) {
+    rebuild_index(std::max(size, MIN_INDEX_SIZE));
+  }
+}
+
+const obj::obj_ptr *obj::ObjMap::find(const obj_ptr &key) const {
+  if (entries.empty()) {
+    return nullptr;
+  }
+  uint32_t pos = index[find_slot(key, key->hash())];
+  return pos == EMPTY ? nullptr : &entries[pos].value;
+}
+
+void obj::ObjMap::insert(const obj_ptr &key, const obj_ptr &value) {
+  // Making room first (in case it's a new key) means the slot is only looked
+  // up once either way
+  size_t needed = index_size_for(entries.size() + 1);
+  if (needed > index.size()) {
+    rebuild_index(std::max(needed, MIN_INDEX_SIZE));
+  }
+
+  uint64_t hash = key->hash();
+  size_t slot = find_slot(key, hash);
+  if (index[slot] != EMPTY) {
+    entries[index[slot]].value = value;
+    return;
+  }
+  index[slot] = entries.size();
+  entries.push_back(Entry{key, value, hash});
+}
+
+// Walks from the key's home slot until it finds either the key or an empty
+// slot, which is where the key would go. There are no deletions, so an empty
+// slot always ends the search.
+size_t obj::ObjMap::find_slot(const obj_ptr &key, uint64_t hash) const {
+  size_t mask = index.size() - 1;
+  for (size_t slot = hash & mask;; slot = (slot + 1) & mask) {
+    uint32_t pos = index[slot];
+    if (pos == EMPTY) {
+      return slot;
+    }
+    const Entry &entry = entries[pos];
+    if (entry.hash == hash && obj::equals(entry.key, key)) {
+      return slot;
+    }
+  }
+}
+
+// Rebuilding only touches the index. The entries stay where they are, and
+// their cached hashes mean no key has to be hashed again.
+void obj::ObjMap::rebuild_index(size_t size) {
+  index.assign(size, EMPTY);
+  size_t mask = size - 1;
+  for (size_t pos = 0; pos < entries.size(); pos++) {
+    size_t slot = entries[pos].hash & mask;
+    while (index[slot] != EMPTY) {
+      slot = (slot + 1) & mask;
+    }
+    index[slot] = pos;
+  }
+}
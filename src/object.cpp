@@ -1,4 +1,7 @@
 #include "object.h"
+#include <atomic>
+#include <sstream>
+#include <thread>
 #include "environment.h"
 
 std::string obj::type_to_string(obj::obj_type ot) {
@@ -48,20 +51,178 @@ std::string obj::Object::wrap(std::string wrapper) {
   return (wrapper + "(" + this->print() + ")");
 }
 
+/**************/
+/* Hash Cache */
+/**************/
+
+namespace {
+
+// Each thread counts in a range of its own, claimed the first time it changes
+// or hashes anything, so a cache stored on one thread never looks current to
+// another. Nothing here is shared, so changing a list on one thread doesn't
+// slow down hashing on the others.
+const uint64_t EPOCH_RANGE = uint64_t(1) << 40;
+std::atomic<uint64_t> claimed_ranges{0};
+thread_local uint64_t thread_epoch = 0;
+
+uint64_t &local_epoch() {
+  if (thread_epoch == 0) {
+    // Starting one range in, so it's never 0 again
+    uint64_t range = claimed_ranges.fetch_add(1, std::memory_order_relaxed);
+    thread_epoch = (range + 1) * EPOCH_RANGE;
+  }
+  return thread_epoch;
+}
+
+// The cached fields only make sense together, and hashing is quick enough
+// that waiting on another thread's store is cheaper than a mutex. Strings use
+// it for flattening too, which saves every string carrying a whole mutex.
+class SpinGuard {
+ public:
+  explicit SpinGuard(std::atomic_flag &flag) : flag(flag) {
+    while (flag.test_and_set(std::memory_order_acquire)) {
+      std::this_thread::yield();
+    }
+  }
+  ~SpinGuard() { flag.clear(std::memory_order_release); }
+
+ private:
+  std::atomic_flag &flag;
+};
+}  // namespace
+
+uint64_t obj::mutation_epoch() { return local_epoch(); }
+
+void obj::forget_nested_hashes() { local_epoch()++; }
+
+bool obj::is_container(const obj::obj_ptr &o) {
+  obj::obj_type type = o->_type();
+  return type == obj::LIST || type == obj::MAP || type == obj::OPTION;
+}
+
+// Versions start at 1, so a cache that was never stored is never valid
+bool obj::HashCache::lookup(uint64_t cur_version, uint64_t &hash) {
+  SpinGuard guard(busy);
+  if (version != cur_version || (nested && epoch != mutation_epoch())) {
+    return false;
+  }
+  hash = value;
+  return true;
+}
+
+void obj::HashCache::store(uint64_t hash, uint64_t cur_version,
+                           bool is_nested) {
+  SpinGuard guard(busy);
+  value = hash;
+  version = cur_version;
+  epoch = mutation_epoch();
+  nested = is_nested;
+}
+
+/************/
+/* Equality */
+/************/
+
+bool obj::equals(const obj::obj_ptr &left, const obj::obj_ptr &right) {
+  if (left == right) {
+    return true;
+  }
+  if (left == nullptr || right == nullptr ||
+      left->_type() != right->_type()) {
+    return false;
+  }
+
+  switch (left->_type()) {
+    case obj::INTEGER: {
+      return fast_cast<obj::Integer>(left)->value ==
+             fast_cast<obj::Integer>(right)->value;
+    } break;
+    case obj::BOOLEAN: {
+      return fast_cast<obj::Bool>(left)->value ==
+             fast_cast<obj::Bool>(right)->value;
+    } break;
+    case obj::STRING: {
+      return fast_cast<obj::String>(left)->get_value() ==
+             fast_cast<obj::String>(right)->get_value();
+    } break;
+    case obj::OPTION: {
+      // Also covers none, whose value is null
+      return equals(fast_cast<obj::Option>(left)->value,
+                    fast_cast<obj::Option>(right)->value);
+    } break;
+    case obj::RANGE: {
+      auto l_range = fast_cast<obj::Range>(left);
+      auto r_range = fast_cast<obj::Range>(right);
+      return l_range->start == r_range->start && l_range->end == r_range->end;
+    } break;
+    case obj::LIST: {
+      const obj::obj_list &l_vals = fast_cast<obj::List>(left)->values;
+      const obj::obj_list &r_vals = fast_cast<obj::List>(right)->values;
+      if (l_vals.size() != r_vals.size()) {
+        return false;
+      }
+      for (size_t i = 0; i < l_vals.size(); i++) {
+        if (!equals(l_vals[i], r_vals[i])) {
+          return false;
+        }
+      }
+      return true;
+    } break;
+    case obj::MAP: {
+      const obj::obj_map &l_pairs = fast_cast<obj::Map>(left)->pairs;
+      const obj::obj_map &r_pairs = fast_cast<obj::Map>(right)->pairs;
+      if (l_pairs.size() != r_pairs.size()) {
+        return false;
+      }
+      for (const auto &entry : l_pairs) {
+        const obj::obj_ptr *other = r_pairs.find(entry.key);
+        if (other == nullptr || !equals(entry.value, *other)) {
+          return false;
+        }
+      }
+      return true;
+    } break;
+    default: {
+      // Functions and builtins go by identity, so they were only equal if they
+      // were the same object
+      return false;
+    }
+  }
+}
+
 /***********/
 /* Integer */
 /***********/
 
-obj::Integer::Integer(int64_t _value) : value(_value) {
-  this->hash_cache =
-      SpookyHash::Hash64(&(_value), sizeof(_value), obj::INTEGER);
+obj::Integer::Integer(int64_t _value)
+    : value(_value) {}
+
+obj::int_ptr obj::make_integer(int64_t value) {
+  // Built on first use, which also keeps it clear of static init ordering
+  static const std::vector<obj::int_ptr> cache = []() {
+    std::vector<obj::int_ptr> ints;
+    ints.reserve(SMALL_INT_MAX - SMALL_INT_MIN + 1);
+    for (int64_t i = SMALL_INT_MIN; i <= SMALL_INT_MAX; i++) {
+      ints.push_back(pool::make<obj::Integer>(i));
+    }
+    return ints;
+  }();
+
+  if (value >= SMALL_INT_MIN && value <= SMALL_INT_MAX) {
+    return cache[value - SMALL_INT_MIN];
+  }
+  return pool::make<obj::Integer>(value);
 }
 
 std::string obj::Integer::print() { return std::to_string(this->value); }
 
 std::string obj::Integer::inspect() { return wrap("INT"); }
 
-uint64_t obj::Integer::hash() { return this->hash_cache; }
+uint64_t obj::Integer::hash() {
+  return hash_cache.get([this]() {
+    return SpookyHash::Hash64(&value, sizeof(value), obj::INTEGER);
+  });
+}
 
 obj::obj_type obj::Integer::_type() { return obj::INTEGER; }
 
@@ -92,16 +253,121 @@ obj::obj_type obj::Bool::_type() { return obj::BOOLEAN; }
 /* String */
 /**********/
 
-obj::String::String(std::string _value) : value(_value) {
-  this->hash_cache =
-      SpookyHash::Hash64(_value.c_str(), _value.length(), obj::STRING);
+obj::String::String(std::string _value)
+    : value(std::move(_value)), flat(true) {
+  length = value.size();
+}
+
+obj::String::String(obj::str_ptr left, obj::str_ptr right)
+    : left(std::move(left)), right(std::move(right)), flat(false) {
+  length = this->left->size() + this->right->size();
+}
+
+// A string built up in a loop is a long chain of nodes, each one holding the
+// last. Letting the default destructor free that would recurse once per node,
+// so the halves nobody else holds are taken apart here one at a time instead.
+obj::String::~String() { let_go(left, right); }
+
+void obj::String::let_go(str_ptr &left, str_ptr &right) {
+  std::vector<str_ptr> pending;
+  if (left != nullptr) pending.push_back(std::move(left));
+  if (right != nullptr) pending.push_back(std::move(right));
+
+  while (!pending.empty()) {
+    str_ptr node = std::move(pending.back());
+    pending.pop_back();
+    if (node.use_count() == 1) {
+      if (node->left != nullptr) pending.push_back(std::move(node->left));
+      if (node->right != nullptr) pending.push_back(std::move(node->right));
+    }
+  }
+}
+
+obj::str_ptr obj::String::concat(const obj::str_ptr &left,
+                                 const obj::str_ptr &right) {
+  if (left->size() == 0) {
+    return right;
+  }
+  if (right->size() == 0) {
+    return left;
+  }
+  if (left->size() + right->size() < MIN_ROPE_LENGTH) {
+    std::string joined = left->get_value() + right->get_value();
+    return pool::make<obj::String>(std::move(joined));
+  }
+  return pool::make<obj::String>(left, right);
+}
+
+// Several threads can reach the same rope at once (see pmap), and flattening
+// rewrites the node in place, so each node is flattened under its own lock.
+// Once a node is flat it never changes again, so reading it needs no lock at
+// all.
+const std::string &obj::String::get_value() {
+  if (!flat.load(std::memory_order_acquire)) {
+    SpinGuard guard(flattening);
+    // Someone else may have got here first
+    if (!flat.load(std::memory_order_relaxed)) {
+      flatten();
+    }
+  }
+  return value;
+}
+
+// Walks the rope left to right with a stack (a chain can be far too deep to
+// recurse over), copying each flat piece into place.
+//
+// Another thread can be flattening a node further down at the same time, and
+// let go of its halves when it's done, so the walk holds on to every node it
+// has yet to visit, and takes a node's lock for as long as it takes to see
+// whether it's flat yet. Locks are only ever taken going down the rope, so two
+// threads can't end up waiting on each other.
+void obj::String::flatten() {
+  std::string out;
+  out.reserve(length);
+
+  std::vector<str_ptr> pending{right, left};
+  while (!pending.empty()) {
+    str_ptr node = std::move(pending.back());
+    pending.pop_back();
+    if (!node->flat.load(std::memory_order_acquire)) {
+      SpinGuard guard(node->flattening);
+      if (!node->flat.load(std::memory_order_relaxed)) {
+        pending.push_back(node->right);
+        pending.push_back(node->left);
+        continue;
+      }
+    }
+    out += node->value;
+  }
+
+  value = std::move(out);
+  flat.store(true, std::memory_order_release);
+  let_go(left, right);
+}
+
+obj::str_ptr obj::make_char(char ch) {
+  static const std::vector<obj::str_ptr> cache = []() {
+    std::vector<obj::str_ptr> chars;
+    chars.reserve(256);
+    for (int i = 0; i < 256; i++) {
+      chars.push_back(pool::make<obj::String>(std::string(1, i)));
+    }
+    return chars;
+  }();
+
+  return cache[static_cast<unsigned char>(ch)];
 }
 
-std::string obj::String::print() { return this->value; }
+std::string obj::String::print() { return get_value(); }
 
 std::string obj::String::inspect() { return wrap("STR"); }
 
-uint64_t obj::String::hash() { return this->hash_cache; }
+uint64_t obj::String::hash() {
+  return hash_cache.get([this]() {
+    const std::string &text = get_value();
+    return SpookyHash::Hash64(text.c_str(), text.length(), obj::STRING);
+  });
+}
 
 obj::obj_type obj::String::_type() { return obj::STRING; }
 
@@ -135,13 +401,19 @@ std::string obj::Option::inspect() {
   }
 }
 
+// The option itself never changes, so its version is always 1. Only what it
+// wraps can.
 uint64_t obj::Option::hash() {
-  // Hashes can be modified by certain methods, so the hash can't be cached
-  // without additional logic that tracks internal changes. Until then, it will
-  // calculate the hash each time using the hash of its internal object.
-  uint64_t internal_hash_value;
-  return SpookyHash::Hash64(&internal_hash_value, sizeof(internal_hash_value),
-                            obj::OPTION);
+  uint64_t cached;
+  if (hash_cache.lookup(1, cached)) {
+    return cached;
+  }
+
+  uint64_t internal_hash_value = value == nullptr ? 0 : value->hash();
+  uint64_t out = SpookyHash::Hash64(
+      &internal_hash_value, sizeof(internal_hash_value), obj::OPTION);
+  hash_cache.store(out, 1, value != nullptr && is_container(value));
+  return out;
 }
 
 obj::obj_type obj::Option::_type() { return obj::OPTION; }
@@ -150,7 +422,12 @@ obj::obj_type obj::Option::_type() { return obj::OPTION; }
 /* List */
 /********/
 
-obj::List::List(obj::obj_list values) : values(values){};
+obj::List::List(obj::obj_list values) : values(std::move(values)), version(1){};
+
+void obj::List::touch() {
+  version++;
+  local_epoch()++;
+}
 
 std::string obj::List::inspect() { return wrap("LIST"); }
 
@@ -170,10 +447,15 @@ std::string obj::List::print() {
   return oss.str();
 }
 
-// Proud of this one (assuming it works). Much like options, the hash is
-// calculated everytime until I add logic to track changes to the internal list
-// for caching purposes.
+// Proud of this one (assuming it works). The hash is cached until the list (or
+// anything inside it) changes, see HashCache.
 uint64_t obj::List::hash() {
+  uint64_t cached;
+  if (hash_cache.lookup(version, cached)) {
+    return cached;
+  }
+
+  bool nested = false;
   obj::obj_list::const_iterator element;
   // Instead of using the type value as the seed argument for each element hash,
   // I'm using it as the starting value and using the element indices as their
@@ -186,8 +468,10 @@ uint64_t obj::List::hash() {
        element++, i++) {
     uint64_t element_hash = (*element)->hash();
     hash_value ^= SpookyHash::Hash64(&(element_hash), sizeof(element_hash), i);
+    nested = nested || is_container(*element);
   }
 
+  hash_cache.store(hash_value, version, nested);
   return hash_value;
 }
 
@@ -197,22 +481,26 @@ obj::obj_type obj::List::_type() { return obj::LIST; }
 /* MAP */
 /*******/
 
-obj::Map::Map(obj::obj_map pairs) : pairs(pairs) {}
+obj::Map::Map(obj::obj_map &&pairs) : pairs(std::move(pairs)), version(1) {}
+
+void obj::Map::touch() {
+  version++;
+  local_epoch()++;
+}
 
 std::string obj::Map::inspect() {
   std::ostringstream oss;
   oss << "MAP( ";
 
-  obj::obj_map::const_iterator iter;
-  size_t i;
-  for (iter = this->pairs.begin(), i = 1; iter != this->pairs.end();
-       iter++, i++) {
-    oss << iter->second.first->inspect();
+  size_t i = 1;
+  for (const auto &entry : this->pairs) {
+    oss << entry.key->inspect();
     oss << ": ";
-    oss << iter->second.second->inspect();
+    oss << entry.value->inspect();
     if (i < this->pairs.size()) {
       oss << ", ";
     }
+    i++;
   }
 
   oss << " )";
@@ -223,16 +511,15 @@ std::string obj::Map::print() {
   std::ostringstream oss;
   oss << "{ ";
 
-  obj::obj_map::const_iterator iter;
-  size_t i;
-  for (iter = this->pairs.begin(), i = 1; iter != this->pairs.end();
-       iter++, i++) {
-    oss << iter->second.first->print();
+  size_t i = 1;
+  for (const auto &entry : this->pairs) {
+    oss << entry.key->print();
     oss << ": ";
-    oss << iter->second.second->print();
+    oss << entry.value->print();
     if (i < this->pairs.size()) {
       oss << ", ";
     }
+    i++;
   }
 
   oss << " }";
@@ -240,21 +527,28 @@ std::string obj::Map::print() {
 }
 
 uint64_t obj::Map::hash() {
+  uint64_t cached;
+  if (hash_cache.lookup(version, cached)) {
+    return cached;
+  }
+
+  bool nested = false;
   uint8_t zero = 0;
   uint64_t out = SpookyHash::Hash64(&zero, sizeof(zero), obj::MAP);
 
-  // Since there's no order to a hashmap (or rather, there shouldn't be), each
-  // element's seed is just the key hash, and the message is the value hash
-  obj::obj_map::const_iterator iter;
-  for (iter = this->pairs.begin(); iter != this->pairs.end(); iter++) {
-    uint64_t key_hash = iter->first;
-    obj_ptr val_obj = iter->second.second;
-    uint64_t val_hash = val_obj->hash();
+  // Maps keep their insertion order, but two maps with the same pairs are still
+  // the same map, so the hash can't depend on order. Each element's seed is
+  // just the key hash (already kept in the entries), and the message is the
+  // value hash.
+  for (const auto &entry : this->pairs) {
+    uint64_t val_hash = entry.value->hash();
     uint64_t element_hash =
-        SpookyHash::Hash64(&val_hash, sizeof(val_hash), key_hash);
+        SpookyHash::Hash64(&val_hash, sizeof(val_hash), entry.hash);
     out ^= element_hash;
+    nested = nested || is_container(entry.key) || is_container(entry.value);
   }
 
+  hash_cache.store(out, version, nested);
   return out;
 }
 
@@ -264,28 +558,42 @@ obj::obj_type obj::Map::_type() { return obj::MAP; }
 /* Range */
 /*********/
 
-bool obj::Range::forward() { return end->value >= start->value; }
+bool obj::Range::forward() { return end >= start; }
 
 bool obj::Range::between(int64_t x) {
   if (forward()) {
-    return start->value <= x && x <= end->value;
+    return start <= x && x <= end;
   } else {
-    return end->value <= x && x <= start->value;
+    return end <= x && x <= start;
   }
 }
 
-obj::Range::Range(obj::int_ptr start, obj::int_ptr end)
+// Adding one since no matter what, a range is inclusive
+uint64_t obj::Range::size() {
+  if (forward()) {
+    return static_cast<uint64_t>(end) - static_cast<uint64_t>(start) + 1;
+  }
+  return static_cast<uint64_t>(start) - static_cast<uint64_t>(end) + 1;
+}
+
+obj::Range::Range(int64_t start, int64_t end)
     : start(start), end(end) {}
 
-std::string obj::Range::print() { return start->print() + ".." + end->print(); }
+std::string obj::Range::print() {
+  return std::to_string(start) + ".." + std::to_string(end);
+}
 
 std::string obj::Range::inspect() { return wrap("RANGE"); }
 
 // Range hash is simply the start int hash xor'd against a shifted end int hash.
+// The ints are hashed the same way Integer does, without making any.
 uint64_t obj::Range::hash() {
-  uint64_t start_hash = start->hash();
-  uint64_t end_hash = end->hash();
-  return start_hash ^ (end_hash << 1);
+  return hash_cache.get([this]() {
+    uint64_t start_hash =
+        SpookyHash::Hash64(&start, sizeof(start), obj::INTEGER);
+    uint64_t end_hash = SpookyHash::Hash64(&end, sizeof(end), obj::INTEGER);
+    return start_hash ^ (end_hash << 1);
+  });
 }
 
 obj::obj_type obj::Range::_type() { return obj::RANGE; }
@@ -295,17 +603,25 @@ obj::obj_type obj::Range::_type() { return obj::RANGE; }
 /************/
 
 obj::Function::Function(ast::func_ptr func_node, env::env_ptr envir)
-    : func_node(func_node), envir(envir) {
-  // At the moment, function hashes are random, but cached and unmodifiable.
-  // Until I can figure out a graceful way to hash the arguments and contents
-  // (and maybe even environment) of a function object, the hash will simply be
-  // tied to the identity of the function. This means that the hash of two
-  // variables pointing to the same function will be equal, but the hashes of
-  // two identically written functions will actually be different. This might
-  // even be the better option, but I don't know enough yet to be sure.
-  uint64_t rand_seed = rand();
+    : Function(func_node, envir, nullptr) {}
+
+obj::Function::Function(ast::func_ptr func_node, env::env_ptr envir,
+                        vm::proto_ptr proto)
+    : func_node(func_node), envir(envir), proto(proto) {
+  // At the moment, function hashes are cached and unmodifiable. Until I can
+  // figure out a graceful way to hash the arguments and contents (and maybe
+  // even environment) of a function object, the hash will simply be tied to
+  // the identity of the function. This means that the hash of two variables
+  // pointing to the same function will be equal, but the hashes of two
+  // identically written functions will actually be different. This might even
+  // be the better option, but I don't know enough yet to be sure.
+  //
+  // The identity is the function's address. It used to be a rand() seed, but
+  // rand() shares its state across threads. No two live functions share an
+  // address, and a function used as a map key stays alive with the map.
+  uintptr_t identity = reinterpret_cast<uintptr_t>(this);
   this->hash_cache =
-      SpookyHash::Hash64(&rand_seed, sizeof(rand_seed), obj::FUNCTION);
+      SpookyHash::Hash64(&identity, sizeof(identity), obj::FUNCTION);
 }
 
 // This is the ugly print that I'm worried about, but I don't feel like printing
@@ -323,7 +639,7 @@ obj::obj_type obj::Function::_type() { return obj::FUNCTION; }
 /* Builtin */
 /***********/
 
-obj::Builtin::Builtin(BI bi) : fn(bi) {}
+obj::Builtin::Builtin(BI bi, std::string_view name) : fn(bi), name(name) {}
 
 // Not sure about printing for builtins. May need to add name member
 std::string obj::Builtin::print() { return "BI"; }
@@ -1,7 +1,8 @@
 #include "parser.h"
 
-// Defining static rank mappings
-rank_map Parser::precedences{
+// Defining static rank mappings. These (like the keywords and builtins) are
+// fixed once the program starts, so any number of parsers can share them.
+const rank_map Parser::precedences{
     {TokenType::ASSIGN, rank::ASSIGN},     {TokenType::DOUBLE_AMP, rank::LOGIC},
     {TokenType::DOUBLE_PIPE, rank::LOGIC}, {TokenType::AMP, rank::BITWISE},
     {TokenType::PIPE, rank::BITWISE},      {TokenType::CARET, rank::BITWISE},
@@ -15,7 +16,7 @@ rank_map Parser::precedences{
     {TokenType::LBRACKET, rank::INDEX},
 };
 
-Parser::Parser(Lexer* lexer) : lexer(lexer) {
+Parser::Parser(Lexer* lexer) : lexer(lexer), arena(new ast::Arena()) {
   // Register Prefix Parsing functions here
   register_prefix(TokenType::IDENT, &parse_identifier);
   // currently, parse_option should not be used outside of let expressions
@@ -87,6 +88,8 @@ Token Parser::get_cur_token() { return cur_token; }
 
 Token Parser::get_peek_token() { return peek_token; }
 
+ast::arena_ptr Parser::get_arena() { return arena; }
+
 bool Parser::cur_token_is(TokenType tt) { return tt == cur_token.get_type(); }
 
 bool Parser::peek_token_is(TokenType tt) { return tt == peek_token.get_type(); }
@@ -156,7 +159,8 @@ void Parser::next_token() {
 }
 
 Parser::rank Parser::cur_precedence() {
-  rank_map::iterator cur_rank = Parser::precedences.find(cur_token.get_type());
+  rank_map::const_iterator cur_rank =
+      Parser::precedences.find(cur_token.get_type());
   if (cur_rank == Parser::precedences.end()) {
     return rank::LOWEST;
   }
@@ -164,7 +168,7 @@ Parser::rank Parser::cur_precedence() {
 }
 
 Parser::rank Parser::peek_precedence() {
-  rank_map::iterator peek_rank =
+  rank_map::const_iterator peek_rank =
       Parser::precedences.find(peek_token.get_type());
   if (peek_rank == Parser::precedences.end()) {
     return rank::LOWEST;
@@ -173,8 +177,8 @@ Parser::rank Parser::peek_precedence() {
 }
 
 ast::block_ptr Parser::parse_program() {
-  Token block_token = Token(TokenType::NONE, "block", 0, 0);
-  ast::block_ptr block = ast::block_ptr(new ast::Block(block_token));
+  Token block_token = Token::fixed(TokenType::NONE, "block", 0, 0);
+  ast::block_ptr block = make_node<ast::Block>(block_token);
 
   int i = 0;
   while (cur_token.get_type() != TokenType::EOF_VAL) {
@@ -183,6 +187,9 @@ ast::block_ptr Parser::parse_program() {
     i++;
   }
 
+  Resolver resolver = Resolver();
+  resolver.resolve_program(block);
+
   return block;
 }
 
@@ -200,12 +207,7 @@ ast::node_ptr Parser::parse_expression(rank r) {
   TokenType cur_type = this->cur_token.get_type();
   prefix_map::iterator prefix = this->prefix_parsers.find(int(cur_type));
   if (prefix == this->prefix_parsers.end()) {
-    // TODO: Add prefix parsing error
-    std::cout << "NO SUCH PREFIX PARSER FOR "
-              << token_type_string(cur_token.get_type()) << std::endl;
-    std::cout << "Current token lit is " << cur_token.get_literal()
-              << std::endl;
-    return ast::node_ptr();
+    throw NoPrefixException(cur_token);
   }
   ast::node_ptr left_expr = prefix->second(*this);
 
@@ -230,13 +232,13 @@ ast::node_ptr Parser::parse_expression(rank r) {
 
 ast::node_ptr parse_identifier(Parser& p) {
   Token cur = p.get_cur_token();
-  return ast::ident_ptr(new ast::Identifier(cur, cur.get_literal()));
+  return p.make_node<ast::Identifier>(cur, cur.get_literal());
 }
 
 ast::node_ptr parse_integer(Parser& p) {
   Token cur = p.get_cur_token();
   int64_t val = std::stoi(cur.get_literal());
-  return ast::int_ptr(new ast::Integer(cur, val));
+  return p.make_node<ast::Integer>(cur, val);
 }
 
 ast::node_ptr parse_let(Parser& p) {
@@ -252,19 +254,19 @@ ast::node_ptr parse_let(Parser& p) {
   }
 
   if (!p.peek_token_is(TokenType::ASSIGN) && name->_type() == ast::OPTION) {
-    return ast::let_ptr(new ast::Let(let_tok, name));
+    return p.make_node<ast::Let>(let_tok, name);
   }
   p.expect_peek(TokenType::ASSIGN);
   p.next_token();
   ast::node_ptr right_expr = p.parse_expression(Parser::LOWEST);
-  return ast::let_ptr(new ast::Let(let_tok, name, right_expr));
+  return p.make_node<ast::Let>(let_tok, name, right_expr);
 }
 
 ast::node_ptr parse_return(Parser& p) {
   Token ret_tok = p.get_cur_token();
   p.next_token();
   ast::node_ptr expr = p.parse_expression(Parser::LOWEST);
-  return ast::return_ptr(new ast::Return(ret_tok, expr));
+  return p.make_node<ast::Return>(ret_tok, expr);
 }
 
 ast::node_ptr parse_prefix(Parser& p) {
@@ -272,34 +274,34 @@ ast::node_ptr parse_prefix(Parser& p) {
   Token op = pre_tok;
   p.next_token();
   ast::node_ptr right_expr = p.parse_expression(Parser::PREFIX);
-  return ast::prefix_ptr(new ast::Prefix(pre_tok, op, right_expr));
+  return p.make_node<ast::Prefix>(pre_tok, op, right_expr);
 }
 
 ast::node_ptr parse_bool(Parser& p) {
   Token bool_tok = p.get_cur_token();
   bool val = bool_tok.get_literal() == "true";
-  return ast::bool_ptr(new ast::Bool(bool_tok, val));
+  return p.make_node<ast::Bool>(bool_tok, val);
 }
 
 ast::node_ptr parse_option(Parser& p) {
   Token cur = p.get_cur_token();
-  return ast::opt_ptr(new ast::Option(cur, cur.get_literal()));
+  return p.make_node<ast::Option>(cur, cur.get_literal());
 }
 
 ast::node_ptr parse_string(Parser& p) {
   Token cur = p.get_cur_token();
-  return ast::str_ptr(new ast::String(cur, cur.get_literal()));
+  return p.make_node<ast::String>(cur, cur.get_literal());
 }
 
 ast::node_ptr parse_list_literal(Parser& p) {
   Token cur = p.get_cur_token();
   ast::node_list values = parse_expression_list(p, TokenType::RBRACKET);
-  return ast::arr_ptr(new ast::List(cur, values));
+  return p.make_node<ast::List>(cur, std::move(values));
 }
 
 ast::node_ptr parse_map_literal(Parser& p) {
   Token cur = p.get_cur_token();
-  ast::map_ptr map = ast::map_ptr(new ast::Map(cur));
+  ast::map_ptr map = p.make_node<ast::Map>(cur);
 
   if (p.peek_token_is(TokenType::RBRACE)) {
     p.next_token();
@@ -317,7 +319,7 @@ ast::node_ptr parse_map_literal(Parser& p) {
     if (key_expr->_type() == ast::IDENT) {
       std::string str =
           std::dynamic_pointer_cast<ast::Identifier>(key_expr)->value;
-      key_expr = ast::str_ptr(new ast::String(p.get_cur_token(), str));
+      key_expr = p.make_node<ast::String>(p.get_cur_token(), str);
     }
 
     p.expect_peek(TokenType::COLON);
@@ -340,7 +342,7 @@ ast::node_ptr parse_map_literal(Parser& p) {
 
 ast::node_ptr parse_if_else(Parser& p) {
   Token if_tok = p.get_cur_token();
-  ast::ifelse_ptr if_else = ast::ifelse_ptr(new ast::IfElse(if_tok));
+  ast::ifelse_ptr if_else = p.make_node<ast::IfElse>(if_tok);
   p.next_token();
 
   ast::node_ptr first_condition = parse_group(p);
@@ -387,13 +389,13 @@ ast::node_ptr parse_infix(Parser& p, ast::node_ptr left_expr) {
   Parser::rank prec = p.cur_precedence();
   p.next_token();
   ast::node_ptr right_expr = p.parse_expression(prec);
-  return ast::infix_ptr(new ast::Infix(tok, op, left_expr, right_expr));
+  return p.make_node<ast::Infix>(tok, op, left_expr, right_expr);
 }
 
 ast::node_ptr parse_call(Parser& p, ast::node_ptr left_expr) {
   Token tok = p.get_cur_token();
   ast::node_list args = parse_expression_list(p, TokenType::RPAREN);
-  return ast::call_ptr(new ast::Call(tok, left_expr, args));
+  return p.make_node<ast::Call>(tok, left_expr, std::move(args));
 }
 
 ast::node_ptr parse_index(Parser& p, ast::node_ptr left_expr) {
@@ -401,7 +403,7 @@ ast::node_ptr parse_index(Parser& p, ast::node_ptr left_expr) {
   p.next_token();
   ast::node_ptr index = p.parse_expression(Parser::LOWEST);
   p.expect_peek(TokenType::RBRACKET);
-  return ast::index_ptr(new ast::Index(tok, left_expr, index));
+  return p.make_node<ast::Index>(tok, left_expr, index);
 }
 
 /********************************/
@@ -418,7 +420,7 @@ ast::node_ptr parse_index(Parser& p, ast::node_ptr left_expr) {
 // ::parse_program()
 ast::block_ptr parse_block(Parser& p) {
   Token block_tok = p.get_cur_token();
-  ast::block_ptr block = ast::block_ptr(new ast::Block(block_tok));
+  ast::block_ptr block = p.make_node<ast::Block>(block_tok);
   p.next_token();
   p.eat_newlines();
   // We don't check for a first line; empty blocks are allowed
@@ -494,7 +496,7 @@ ast::node_ptr parse_function_literal(Parser& p) {
   p.next_token();
   p.expect_peek(TokenType::LBRACE);
   ast::block_ptr body = parse_block(p);
-  return ast::func_ptr(new ast::Function(tok, params, body));
+  return p.make_node<ast::Function>(tok, std::move(params), body);
 }
 
 // The group node type was added mostly as a convenience for map literals, where
@@ -514,5 +516,5 @@ ast::node_ptr parse_group(Parser& p) {
   p.next_token();
   ast::node_ptr expr = p.parse_expression(Parser::LOWEST);
   p.expect_peek(TokenType::RPAREN);
-  return ast::grp_ptr(new ast::Group(cur, expr));
+  return p.make_node<ast::Group>(cur, expr);
 }
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "pool.h"
+#include <cstdint>
+
+namespace {
+
+const size_t SIZE_CLASSES = pool::MAX_SIZE / pool::SIZE_STEP;
+
+// A free block holds the next free block in its first bytes
+struct Block {
+  Block *next;
+};
+
+struct FreeList {
+  Block *head;
+  uint32_t count;
+};
+
+// Plain data, so they're ready before anything runs and still readable after
+// the thread's destructors have run. Blocks freed that late (like the
+// singletons in builtin.cpp, at exit) see `closed` and go straight to malloc.
+struct Lists {
+  FreeList by_size[SIZE_CLASSES];
+  bool registered;
+  bool closed;
+};
+
+thread_local Lists lists;
+
+// Only made once the thread has something to give back, so threads that never
+// free anything don't pay for it
+struct Drain {
+  ~Drain() {
+    lists.closed = true;
+    for (FreeList &list : lists.by_size) {
+      while (list.head != nullptr) {
+        Block *block = list.head;
+        list.head = block->next;
+        ::operator delete(block);
+      }
+      list.count = 0;
+    }
+  }
+};
+
+size_t size_class(size_t size) { return (size - 1) / pool::SIZE_STEP; }
+
+}  // namespace
+
+void *pool::take(size_t size) {
+  FreeList &list = lists.by_size[size_class(size)];
+  if (list.head == nullptr) {
+    // Always the full size of the class, so the block can go to anything in it
+    return ::operator new((size_class(size) + 1) * SIZE_STEP);
+  }
+  Block *block = list.head;
+  list.head = block->next;
+  list.count--;
+  return block;
+}
+
+void pool::give(void *ptr, size_t size) {
+  FreeList &list = lists.by_size[size_class(size)];
+  if (lists.closed || list.count >= MAX_FREE) {
+    ::operator delete(ptr);
+    return;
+  }
+  if (!lists.registered) {
+    thread_local Drain drain;
+    lists.registered = true;
+  }
+  Block *block = static_cast<Block *>(ptr);
+  block->next = list.head;
+  list.head = block;
+  list.count++;
+}
+
+size_t pool::free_count(size_t size) {
+  return lists.by_size[size_class(size)].count;
+}
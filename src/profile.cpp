@@ -0,0 +1,322 @@
+#include "profile.h"
+
+#ifndef PARTH_PROFILE
+
+void prof::report_flat(std::ostream &out) {
+  out << "Profiling isn't built in, rebuild with `make PROFILE=1`\n";
+}
+
+void prof::report_collapsed(std::ostream &) {}
+
+void prof::reset() {}
+
+#else
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace prof {
+
+const size_t NODE_TYPES = ast::INDEX + 1;
+// The frame every stack starts from
+const uint32_t ROOT_FRAME = 0;
+
+struct Stat {
+  uint64_t count = 0;
+  uint64_t self_ns = 0;
+  uint64_t total_ns = 0;
+};
+
+// One frame of the call tree. The same function called from two different
+// places gets two nodes, which is what the collapsed stacks are made from.
+struct CallNode {
+  CallNode(uint32_t frame, CallNode *parent) : frame(frame), parent(parent) {}
+
+  uint32_t frame;
+  CallNode *parent;
+  uint64_t self_ns = 0;
+  std::unordered_map<uint32_t, std::unique_ptr<CallNode>> children;
+};
+
+struct ThreadProfile {
+  Stat nodes[NODE_TYPES];
+  // By frame ID
+  std::vector<Stat> frames;
+  // How many calls to each frame are running, so a recursive function's total
+  // time is only counted once, by its outermost call
+  std::vector<uint32_t> active;
+
+  CallNode root{ROOT_FRAME, nullptr};
+  CallNode *current = &root;
+
+  // Time spent in nested timers, one entry per timer that's running
+  std::vector<uint64_t> node_children;
+  std::vector<uint64_t> call_children;
+
+  // Frame IDs this thread has already looked up, by function node or builtin
+  std::unordered_map<const void *, uint32_t> frame_ids;
+};
+
+}  // namespace prof
+
+namespace {
+
+// Frame names are shared by every thread, so the same function gets the same
+// ID no matter which thread called it first
+struct Registry {
+  std::mutex lock;
+  std::vector<std::string> labels{"main"};
+  std::unordered_map<std::string, uint32_t> ids;
+  std::vector<std::shared_ptr<prof::ThreadProfile>> threads;
+};
+
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+prof::ThreadProfile &local_profile() {
+  thread_local std::shared_ptr<prof::ThreadProfile> profile = []() {
+    auto made = std::make_shared<prof::ThreadProfile>();
+    Registry &r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    r.threads.push_back(made);
+    return made;
+  }();
+  return *profile;
+}
+
+uint64_t now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// The label is only put together the first time this thread sees the key
+template <typename F>
+uint32_t frame_id(prof::ThreadProfile &profile, const void *key, F label) {
+  auto cached = profile.frame_ids.find(key);
+  if (cached != profile.frame_ids.end()) {
+    return cached->second;
+  }
+
+  std::string name = label();
+  uint32_t id;
+  {
+    Registry &r = registry();
+    std::lock_guard<std::mutex> guard(r.lock);
+    auto found = r.ids.find(name);
+    if (found != r.ids.end()) {
+      id = found->second;
+    } else {
+      id = r.labels.size();
+      r.labels.push_back(name);
+      r.ids.emplace(name, id);
+    }
+  }
+  profile.frame_ids.emplace(key, id);
+  return id;
+}
+
+// Ends a timer, taking the time spent in the timers nested under it out of its
+// self time, and counting its own time against the timer it's nested in
+uint64_t pop_self_time(std::vector<uint64_t> &children, uint64_t elapsed) {
+  uint64_t nested = children.back();
+  children.pop_back();
+  if (!children.empty()) {
+    children.back() += elapsed;
+  }
+  return elapsed - std::min(nested, elapsed);
+}
+
+double to_ms(uint64_t ns) { return ns / 1e6; }
+
+void collect_stacks(const prof::CallNode &node, const std::string &prefix,
+                    const std::vector<std::string> &labels,
+                    std::map<std::string, uint64_t> &stacks) {
+  std::string path = prefix.empty() ? labels[node.frame]
+                                    : prefix + ";" + labels[node.frame];
+  if (node.self_ns > 0) {
+    stacks[path] += node.self_ns;
+  }
+  for (const auto &child : node.children) {
+    collect_stacks(*child.second, path, labels, stacks);
+  }
+}
+
+}  // namespace
+
+/*************/
+/*** Hooks ***/
+/*************/
+
+prof::NodeTimer::NodeTimer(ast::node_type type)
+    : profile(local_profile()), type(type), start(0) {
+  profile.node_children.push_back(0);
+  start = now();
+}
+
+prof::NodeTimer::~NodeTimer() {
+  uint64_t elapsed = now() - start;
+  Stat &stat = profile.nodes[type];
+  stat.count++;
+  stat.self_ns += pop_self_time(profile.node_children, elapsed);
+}
+
+prof::CallTimer::CallTimer(const ast::Function &func)
+    : profile(local_profile()), start(0) {
+  enter(frame_id(profile, &func, [&func]() {
+    return "fn@" + std::to_string(func.token.get_line()) + ":" +
+           std::to_string(func.token.get_column());
+  }));
+}
+
+// Builtins go by the name they were called as, so len() and its alias count()
+// show up separately. Host builtins have no name, so they go by the function.
+prof::CallTimer::CallTimer(const obj::Builtin &builtin)
+    : profile(local_profile()), start(0) {
+  const void *key = builtin.name.empty()
+                        ? reinterpret_cast<const void *>(builtin.fn)
+                        : builtin.name.data();
+  enter(frame_id(profile, key, [&builtin]() {
+    return builtin.name.empty() ? std::string("builtin")
+                                : std::string(builtin.name);
+  }));
+}
+
+void prof::CallTimer::enter(uint32_t frame) {
+  if (frame >= profile.frames.size()) {
+    profile.frames.resize(frame + 1);
+    profile.active.resize(frame + 1);
+  }
+
+  std::unique_ptr<CallNode> &child = profile.current->children[frame];
+  if (child == nullptr) {
+    child.reset(new CallNode(frame, profile.current));
+  }
+  profile.current = child.get();
+  profile.active[frame]++;
+  profile.call_children.push_back(0);
+  start = now();
+}
+
+prof::CallTimer::~CallTimer() {
+  uint64_t elapsed = now() - start;
+  uint64_t self = pop_self_time(profile.call_children, elapsed);
+
+  uint32_t frame = profile.current->frame;
+  Stat &stat = profile.frames[frame];
+  stat.count++;
+  stat.self_ns += self;
+  if (--profile.active[frame] == 0) {
+    stat.total_ns += elapsed;
+  }
+
+  profile.current->self_ns += self;
+  profile.current = profile.current->parent;
+}
+
+/***************/
+/*** Reports ***/
+/***************/
+
+void prof::report_flat(std::ostream &out) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+
+  Stat nodes[NODE_TYPES];
+  std::vector<Stat> frames(r.labels.size());
+  for (const auto &thread : r.threads) {
+    for (size_t i = 0; i < NODE_TYPES; i++) {
+      nodes[i].count += thread->nodes[i].count;
+      nodes[i].self_ns += thread->nodes[i].self_ns;
+    }
+    for (size_t i = 0; i < thread->frames.size(); i++) {
+      frames[i].count += thread->frames[i].count;
+      frames[i].self_ns += thread->frames[i].self_ns;
+      frames[i].total_ns += thread->frames[i].total_ns;
+    }
+  }
+
+  uint64_t node_total = 0;
+  std::vector<size_t> order;
+  for (size_t i = 0; i < NODE_TYPES; i++) {
+    node_total += nodes[i].self_ns;
+    if (nodes[i].count > 0) order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&nodes](size_t a, size_t b) {
+    return nodes[a].self_ns > nodes[b].self_ns;
+  });
+
+  out << std::fixed << std::setprecision(3);
+  out << std::left << std::setw(12) << "node" << std::right << std::setw(12)
+      << "evals" << std::setw(14) << "self ms" << std::setw(9) << "self %"
+      << "\n";
+  for (size_t i : order) {
+    double share = node_total == 0 ? 0 : 100.0 * nodes[i].self_ns / node_total;
+    out << std::left << std::setw(12)
+        << ast::node_type_string(static_cast<ast::node_type>(i)) << std::right
+        << std::setw(12) << nodes[i].count << std::setw(14)
+        << to_ms(nodes[i].self_ns) << std::setw(8) << std::setprecision(1)
+        << share << "%" << std::setprecision(3) << "\n";
+  }
+
+  order.clear();
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (frames[i].count > 0) order.push_back(i);
+  }
+  std::sort(order.begin(), order.end(), [&frames](size_t a, size_t b) {
+    return frames[a].self_ns > frames[b].self_ns;
+  });
+
+  out << "\n"
+      << std::left << std::setw(20) << "call" << std::right << std::setw(12)
+      << "calls" << std::setw(14) << "self ms" << std::setw(14) << "total ms"
+      << "\n";
+  for (size_t i : order) {
+    out << std::left << std::setw(20) << r.labels[i] << std::right
+        << std::setw(12) << frames[i].count << std::setw(14)
+        << to_ms(frames[i].self_ns) << std::setw(14)
+        << to_ms(frames[i].total_ns) << "\n";
+  }
+}
+
+void prof::report_collapsed(std::ostream &out) {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+
+  std::map<std::string, uint64_t> stacks;
+  for (const auto &thread : r.threads) {
+    collect_stacks(thread->root, "", r.labels, stacks);
+  }
+  for (const auto &stack : stacks) {
+    out << stack.first << " " << stack.second << "\n";
+  }
+}
+
+void prof::reset() {
+  Registry &r = registry();
+  std::lock_guard<std::mutex> guard(r.lock);
+  for (const auto &thread : r.threads) {
+    for (Stat &stat : thread->nodes) {
+      stat = Stat();
+    }
+    thread->frames.clear();
+    thread->active.clear();
+    thread->root.children.clear();
+    thread->root.self_ns = 0;
+    thread->current = &thread->root;
+    // The nodes these point at may be gone by the next run, and another node
+    // could end up at the same address
+    thread->frame_ids.clear();
+  }
+}
+
+#endif
@@ -0,0 +1,181 @@
+#include "resolver.h"
+#include "builtin.h"
+#include "util.h"
+
+void Resolver::resolve_program(ast::block_ptr program) {
+  scopes.clear();
+  resolve_scope(program, nullptr);
+}
+
+void Resolver::resolve_scope(ast::block_ptr body,
+                             const ast::param_list *params) {
+  scopes.push_back(Scope());
+
+  if (params != nullptr) {
+    for (auto param = params->begin(); param != params->end(); param++) {
+      declare(*param);
+    }
+  }
+
+  resolve(body);
+
+  // Everything in this scope is declared by now, so the functions it defines
+  // can see all of it. Indexing rather than iterating, since resolving a body
+  // can grow the scope stack.
+  for (size_t i = 0; i < scopes.back().deferred.size(); i++) {
+    ast::func_ptr func_node = scopes.back().deferred[i];
+    resolve_scope(func_node->body, &func_node->params);
+  }
+
+  body->slot_count = scopes.back().slots.size();
+  scopes.pop_back();
+}
+
+void Resolver::resolve(ast::node_ptr node) {
+  if (node == nullptr) {
+    return;
+  }
+
+  switch (node->_type()) {
+    case ast::BLOCK: {
+      auto block = fast_cast<ast::Block>(node);
+      for (auto &line : block->nodes) {
+        resolve(line);
+      }
+    } break;
+
+    case ast::IDENT: {
+      resolve_ident(fast_cast<ast::Identifier>(node));
+    } break;
+
+    case ast::LET: {
+      // The expression comes first, since the new variable doesn't exist
+      // until it's been evaluated
+      auto let = fast_cast<ast::Let>(node);
+      resolve(let->expression);
+      declare(let->name);
+    } break;
+
+    case ast::ASSIGN: {
+      auto assign = fast_cast<ast::Assign>(node);
+      resolve(assign->expression);
+      resolve_ident(assign->name);
+    } break;
+
+    case ast::RETURN: {
+      resolve(fast_cast<ast::Return>(node)->expression);
+    } break;
+
+    case ast::LIST: {
+      auto list = fast_cast<ast::List>(node);
+      for (auto &value : list->values) {
+        resolve(value);
+      }
+    } break;
+
+    case ast::MAP: {
+      auto map = fast_cast<ast::Map>(node);
+      for (auto &kv : map->key_value_pairs) {
+        resolve(kv.first);
+        resolve(kv.second);
+      }
+    } break;
+
+    case ast::PREFIX: {
+      resolve(fast_cast<ast::Prefix>(node)->right);
+    } break;
+
+    case ast::INFIX: {
+      auto infix = fast_cast<ast::Infix>(node);
+      resolve(infix->left);
+      resolve(infix->right);
+    } break;
+
+    case ast::GROUP: {
+      resolve(fast_cast<ast::Group>(node)->expr);
+    } break;
+
+    case ast::IF_ELSE: {
+      auto if_else = fast_cast<ast::IfElse>(node);
+      for (auto &set : if_else->list) {
+        resolve(set.condition);
+        resolve(set.consequence);
+      }
+    } break;
+
+    case ast::FUNCTION: {
+      scopes.back().deferred.push_back(fast_cast<ast::Function>(node));
+    } break;
+
+    case ast::CALL: {
+      auto call = fast_cast<ast::Call>(node);
+      resolve(call->function);
+      for (auto &arg : call->args) {
+        resolve(arg);
+      }
+    } break;
+
+    case ast::INDEX: {
+      auto index = fast_cast<ast::Index>(node);
+      resolve(index->left);
+      resolve(index->index);
+    } break;
+
+    default:
+      // Literals have nothing to resolve
+      break;
+  }
+}
+
+void Resolver::resolve_ident(ast::ident_ptr ident) {
+  ident->depth = -1;
+  ident->slot = -1;
+  ident->shadows.clear();
+
+  if (Builtins::is_builtin(ident->symbol)) {
+    return;
+  }
+
+  // Stopping short of the program scope, since globals stay by name. The
+  // nearest declaration is the variable, and any further out are what it
+  // shadows.
+  for (size_t i = scopes.size(); i > 1; i--) {
+    auto found = scopes[i - 1].slots.find(ident->symbol);
+    if (found == scopes[i - 1].slots.end()) {
+      continue;
+    }
+    int depth = scopes.size() - i;
+    if (ident->slot < 0) {
+      ident->depth = depth;
+      ident->slot = found->second;
+    } else {
+      ident->shadows.emplace_back(depth, found->second);
+    }
+  }
+}
+
+// Declaring the same name twice in a scope (say, in both branches of an
+// if-else) gives it the same slot. Whether that's allowed is still up to the
+// environment at runtime.
+void Resolver::declare(ast::ident_ptr ident) {
+  if (scopes.size() == 1) {
+    ident->depth = -1;
+    ident->slot = -1;
+    return;
+  }
+
+  std::unordered_map<symbol_id, int> &slots = scopes.back().slots;
+  symbol_id name = ident->symbol;
+
+  auto found = slots.find(name);
+  int slot;
+  if (found != slots.end()) {
+    slot = found->second;
+  } else {
+    slot = slots.size();
+    slots[name] = slot;
+  }
+
+  ident->depth = 0;
+  ident->slot = slot;
+}
@@ -0,0 +1,189 @@
+#include "sampler.h"
+#include <sys/time.h>
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+namespace {
+
+// How many frames a sample keeps, innermost first. The rest are cut off.
+const size_t SAMPLE_DEPTH = 64;
+// Frames are kept in one pool that all the samples share, since most stacks
+// are only a few frames deep. This is how many it has room for per sample, on
+// average, so the odd deep one still fits.
+const size_t FRAMES_PER_SAMPLE = 16;
+
+struct Sample {
+  // Where its frames start in the pool
+  size_t first;
+  uint32_t depth;
+  // Whether the bottom of the stack didn't fit
+  bool truncated;
+};
+
+// Everything the handler touches. It's all set up by start() before the timer
+// goes, and only torn down by the next start(), after the timer's been stopped.
+struct Samples {
+  std::unique_ptr<Sample[]> buffer;
+  size_t capacity = 0;
+  std::unique_ptr<sample::Frame[]> frames;
+  size_t frame_capacity = 0;
+  // Slots and frames are claimed by bumping these, so handlers on two threads
+  // at once never write the same one. They can go past capacity, which is how
+  // the dropped samples are counted.
+  std::atomic<size_t> taken{0};
+  std::atomic<size_t> frames_taken{0};
+  // Samples that had a slot but whose frames didn't fit
+  std::atomic<size_t> out_of_frames{0};
+  std::atomic<bool> running{false};
+  // Handlers that are partway through, which stop() waits out
+  std::atomic<int> busy{0};
+  struct sigaction previous;
+};
+
+Samples samples;
+
+void take_sample(int) {
+  int saved_errno = errno;
+  samples.busy.fetch_add(1);
+  if (samples.running.load()) {
+    size_t slot = samples.taken.fetch_add(1, std::memory_order_relaxed);
+    if (slot < samples.capacity) {
+      sample::CallStack &stack = sample::call_stack();
+      uint32_t depth = stack.depth.load(std::memory_order_relaxed);
+      std::atomic_signal_fence(std::memory_order_acquire);
+      // Frames past MAX_DEPTH weren't kept, so those calls are cut off too
+      uint32_t kept = std::min<uint32_t>(depth, sample::CallStack::MAX_DEPTH);
+      uint32_t copied = std::min<uint32_t>(kept, SAMPLE_DEPTH);
+
+      size_t first =
+          samples.frames_taken.fetch_add(copied, std::memory_order_relaxed);
+      Sample &out = samples.buffer[slot];
+      if (first + copied > samples.frame_capacity) {
+        // Kept as an empty sample, and left out when they're written
+        out.depth = 0;
+        samples.out_of_frames.fetch_add(1, std::memory_order_relaxed);
+      } else {
+        out.first = first;
+        out.depth = copied;
+        out.truncated = copied < depth;
+        for (uint32_t i = 0; i < copied; i++) {
+          samples.frames[first + i] = stack.frames[kept - copied + i];
+        }
+      }
+    }
+  }
+  samples.busy.fetch_sub(1);
+  errno = saved_errno;
+}
+
+void set_timer(long interval_us) {
+  struct itimerval timer = {};
+  timer.it_interval.tv_usec = interval_us % 1000000;
+  timer.it_interval.tv_sec = interval_us / 1000000;
+  timer.it_value = timer.it_interval;
+  setitimer(ITIMER_PROF, &timer, nullptr);
+}
+
+std::string label(const sample::Frame &frame, bool bottom) {
+  std::string name;
+  if (frame.builtin != nullptr) {
+    return frame.builtin;
+  } else if (frame.func_line == 0 && bottom) {
+    name = "main";
+  } else {
+    name = "fn@" + std::to_string(frame.func_line) + ":" +
+           std::to_string(frame.func_column);
+  }
+  return name + ":" + std::to_string(frame.line);
+}
+
+}  // namespace
+
+void sample::start(int hz, size_t capacity) {
+  if (hz <= 0 || hz > 1000000) {
+    throw std::runtime_error("Sampling rate must be between 1 and 1000000");
+  }
+  if (samples.running.load()) {
+    throw std::runtime_error("The sampler is already running");
+  }
+
+  samples.buffer.reset(new Sample[capacity]);
+  samples.capacity = capacity;
+  samples.frame_capacity = capacity * FRAMES_PER_SAMPLE;
+  samples.frames.reset(new sample::Frame[samples.frame_capacity]);
+  samples.taken.store(0);
+  samples.frames_taken.store(0);
+  samples.out_of_frames.store(0);
+
+  struct sigaction action = {};
+  action.sa_handler = &take_sample;
+  sigemptyset(&action.sa_mask);
+  // A sample shouldn't make a read() or the like fail with EINTR
+  action.sa_flags = SA_RESTART;
+  if (sigaction(SIGPROF, &action, &samples.previous) != 0) {
+    throw std::runtime_error("Couldn't install the SIGPROF handler");
+  }
+
+  samples.running.store(true);
+  set_timer(1000000 / hz);
+}
+
+void sample::stop() {
+  if (!samples.running.load()) {
+    return;
+  }
+  set_timer(0);
+  samples.running.store(false);
+  // A signal already on its way to another thread could still be copying
+  while (samples.busy.load() > 0) {
+    std::this_thread::yield();
+  }
+  sigaction(SIGPROF, &samples.previous, nullptr);
+}
+
+bool sample::running() { return samples.running.load(); }
+
+size_t sample::sample_count() {
+  return std::min(samples.taken.load(), samples.capacity) -
+         samples.out_of_frames.load();
+}
+
+size_t sample::dropped() {
+  size_t taken = samples.taken.load();
+  return (taken > samples.capacity ? taken - samples.capacity : 0) +
+         samples.out_of_frames.load();
+}
+
+void sample::write_folded(std::ostream &out) {
+  // A signal mid-write would be reading a slot that's still being filled
+  if (running()) {
+    throw std::runtime_error("Stop the sampler before writing its samples");
+  }
+
+  std::map<std::string, size_t> stacks;
+  size_t filled = std::min(samples.taken.load(), samples.capacity);
+  for (size_t i = 0; i < filled; i++) {
+    const Sample &sample = samples.buffer[i];
+    if (sample.depth == 0) {
+      continue;
+    }
+    const sample::Frame *frames = &samples.frames[sample.first];
+    std::string path = sample.truncated ? "..." : "";
+    for (uint32_t f = 0; f < sample.depth; f++) {
+      if (!path.empty()) {
+        path += ";";
+      }
+      path += label(frames[f], f == 0 && !sample.truncated);
+    }
+    stacks[path]++;
+  }
+  for (const auto &stack : stacks) {
+    out << stack.first << " " << stack.second << "\n";
+  }
+}
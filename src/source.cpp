@@ -0,0 +1,48 @@
+#include "source.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include "parth_error.h"
+
+SourceFile::SourceFile(const std::string &path)
+    : path(path), data(nullptr), size(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw SourceException(path, std::strerror(errno));
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) < 0) {
+    int err = errno;
+    close(fd);
+    throw SourceException(path, std::strerror(err));
+  }
+
+  // mmap won't map zero bytes, but an empty script is still a valid script
+  size = info.st_size;
+  if (size == 0) {
+    close(fd);
+    return;
+  }
+
+  void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  int err = errno;
+  // The mapping holds its own reference to the file
+  close(fd);
+  if (mapped == MAP_FAILED) {
+    throw SourceException(path, std::strerror(err));
+  }
+
+  // The lexer only ever moves forward, so let the kernel read ahead
+  madvise(mapped, size, MADV_SEQUENTIAL);
+  data = static_cast<const char *>(mapped);
+}
+
+SourceFile::~SourceFile() {
+  if (data != nullptr) {
+    munmap(const_cast<char *>(data), size);
+  }
+}
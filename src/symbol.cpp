@@ -0,0 +1,72 @@
+#include "symbol.h"
+#include <vector>
+
+namespace {
+
+// What this thread has already looked up. Interned text never moves, so the
+// views can be kept here, and a name only costs a trip through the shared
+// table's lock the first time a thread sees it.
+struct LocalCache {
+  std::unordered_map<std::string_view, symbol_id> ids;
+  std::vector<std::string_view> names;
+};
+
+LocalCache &local_cache() {
+  thread_local LocalCache cache;
+  return cache;
+}
+
+}  // namespace
+
+SymbolTable::Table &SymbolTable::table() {
+  static Table instance;
+  return instance;
+}
+
+symbol_id SymbolTable::intern(std::string_view text) {
+  LocalCache &cache = local_cache();
+  auto cached = cache.ids.find(text);
+  if (cached != cache.ids.end()) {
+    return cached->second;
+  }
+
+  symbol_id id;
+  std::string_view interned;
+  {
+    Table &t = table();
+    std::lock_guard<std::mutex> guard(t.lock);
+    auto found = t.ids.find(text);
+    if (found != t.ids.end()) {
+      id = found->second;
+      interned = found->first;
+    } else {
+      t.names.emplace_back(text);
+      id = t.names.size() - 1;
+      interned = t.names.back();
+      t.ids.emplace(interned, id);
+    }
+  }
+
+  cache.ids.emplace(interned, id);
+  return id;
+}
+
+std::string_view SymbolTable::name(symbol_id id) {
+  LocalCache &cache = local_cache();
+  if (id < cache.names.size() && !cache.names[id].empty()) {
+    return cache.names[id];
+  }
+
+  std::string_view interned;
+  {
+    Table &t = table();
+    std::lock_guard<std::mutex> guard(t.lock);
+    interned = t.names[id];
+  }
+
+  if (id >= cache.names.size()) {
+    cache.names.resize(id + 1);
+  }
+  cache.names[id] = interned;
+  return interned;
+}
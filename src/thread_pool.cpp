@@ -0,0 +1,154 @@
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdint>
+#include <exception>
+
+namespace {
+
+// Stands in for a worker's own id when the caller of parallel_for() isn't a
+// worker, so it only ever steals
+const size_t NO_HOME = SIZE_MAX;
+
+// What one call to parallel_for() keeps track of while its chunks run
+struct Batch {
+  std::atomic<size_t> remaining;
+  std::mutex error_lock;
+  std::exception_ptr error;
+};
+
+}  // namespace
+
+ThreadPool::ThreadPool(size_t thread_count)
+    : next_worker(0), queued(0), stopping(false) {
+  thread_count = std::max<size_t>(thread_count, 1);
+  for (size_t i = 0; i < thread_count; i++) {
+    workers.push_back(std::unique_ptr<Worker>(new Worker()));
+  }
+  // Only started once every worker exists, since any of them can steal from
+  // any other
+  for (size_t i = 0; i < thread_count; i++) {
+    workers[i]->thread = std::thread(&ThreadPool::work, this, i);
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> guard(sleep_lock);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto &worker : workers) {
+    worker->thread.join();
+  }
+}
+
+ThreadPool &ThreadPool::shared() {
+  static ThreadPool pool(std::thread::hardware_concurrency());
+  return pool;
+}
+
+void ThreadPool::parallel_for(size_t count, size_t grain,
+                              const std::function<void(size_t, size_t)> &body) {
+  grain = std::max<size_t>(grain, 1);
+  // Not worth handing out
+  if (count <= grain) {
+    if (count > 0) {
+      body(0, count);
+    }
+    return;
+  }
+
+  auto batch = std::make_shared<Batch>();
+  size_t chunks = (count + grain - 1) / grain;
+  batch->remaining.store(chunks);
+  for (size_t begin = 0; begin < count; begin += grain) {
+    size_t end = std::min(count, begin + grain);
+    push([batch, &body, begin, end]() {
+      try {
+        body(begin, end);
+      } catch (...) {
+        std::lock_guard<std::mutex> guard(batch->error_lock);
+        if (batch->error == nullptr) {
+          batch->error = std::current_exception();
+        }
+      }
+      batch->remaining.fetch_sub(1, std::memory_order_acq_rel);
+    });
+  }
+
+  // Helping out rather than waiting. Whatever gets picked up might belong to
+  // some other loop, which is fine, it all has to get done.
+  while (batch->remaining.load(std::memory_order_acquire) > 0) {
+    Task task;
+    if (pop(NO_HOME, task)) {
+      task();
+    } else {
+      std::this_thread::yield();
+    }
+  }
+
+  if (batch->error != nullptr) {
+    std::rethrow_exception(batch->error);
+  }
+}
+
+void ThreadPool::push(Task task) {
+  size_t id = next_worker.fetch_add(1, std::memory_order_relaxed);
+  Worker &worker = *workers[id % workers.size()];
+  {
+    std::lock_guard<std::mutex> guard(worker.lock);
+    worker.tasks.push_back(std::move(task));
+  }
+  queued.fetch_add(1);
+
+  // Taking the lock, even for nothing, means a worker can't be caught between
+  // checking for work and going to sleep, and miss this
+  { std::lock_guard<std::mutex> guard(sleep_lock); }
+  wake.notify_one();
+}
+
+// A worker takes the newest task from its own queue, and failing that the
+// oldest one from someone else's. Taking from opposite ends keeps the owner and
+// the thieves out of each other's way.
+bool ThreadPool::pop(size_t home, Task &task) {
+  size_t count = workers.size();
+  if (home != NO_HOME) {
+    Worker &own = *workers[home];
+    std::lock_guard<std::mutex> guard(own.lock);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      queued.fetch_sub(1);
+      return true;
+    }
+  }
+
+  size_t start = home == NO_HOME ? 0 : home + 1;
+  for (size_t i = 0; i < count; i++) {
+    Worker &victim = *workers[(start + i) % count];
+    std::lock_guard<std::mutex> guard(victim.lock);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      queued.fetch_sub(1);
+      return true;
+    }
+  }
+  return false;
+}
+
+void ThreadPool::work(size_t id) {
+  while (true) {
+    Task task;
+    if (pop(id, task)) {
+      task();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> guard(sleep_lock);
+    wake.wait(guard, [this]() { return queued.load() > 0 || stopping; });
+    if (stopping && queued.load() == 0) {
+      return;
+    }
+  }
+}
@@ -4,18 +4,37 @@
 Token::Token() {
   type = TokenType::NONE;
   literal = "";
+  symbol = NO_SYMBOL;
+  column = 0;
+  line = 0;
 }
 
-Token::Token(TokenType _type, std::string _literal, uint _column, uint _line) {
+Token::Token(TokenType _type, std::string_view _literal, uint _column,
+             uint _line) {
   type = _type;
-  literal = _literal;
+  symbol = SymbolTable::intern(_literal);
+  literal = SymbolTable::name(symbol);
   column = _column;
   line = _line;
 }
 
+Token Token::fixed(TokenType _type, std::string_view _literal, uint _column,
+                   uint _line) {
+  Token tok = Token();
+  tok.type = _type;
+  tok.literal = _literal;
+  tok.column = _column;
+  tok.line = _line;
+  return tok;
+}
+
 TokenType Token::get_type() const { return type; }
 
-std::string Token::get_literal() const { return literal; }
+std::string Token::get_literal() const { return std::string(literal); }
+
+std::string_view Token::literal_view() const { return literal; }
+
+symbol_id Token::get_symbol() const { return symbol; }
 
 uint Token::get_column() const { return column; }
 
@@ -25,9 +44,13 @@ bool Token::is_empty() const {
   return type == TokenType::NONE && literal == "";
 }
 
-TokenType Token::lookup_ident(std::string &ident) {
+TokenType Token::lookup_ident(std::string_view ident,
+                              std::string_view *keyword) {
   keyword_map::const_iterator got = keywords.find(ident);
   if (got != keywords.end()) {
+    if (keyword != nullptr) {
+      *keyword = got->first;
+    }
     return got->second;
   }
   if (ident.back() == '?') {
@@ -37,11 +60,11 @@ TokenType Token::lookup_ident(std::string &ident) {
 }
 
 // Used for lookup of keywords in Token::lookup_ident
-keyword_map Token::keywords({
+const keyword_map Token::keywords({
     {"let", TokenType::LET},
     {"if", TokenType::IF},
     {"else", TokenType::ELSE},
     {"return", TokenType::RETURN},
     {"true", TokenType::TRUE_VAL},
     {"false", TokenType::FALSE_VAL},
-});
\ No newline at end of file
+});
@@ -0,0 +1,83 @@
+#include "value.h"
+#include "builtin.h"
+#include "util.h"
+
+obj::Value::Value() : kind(EMPTY), num(0) {}
+
+// Integers and bools are unpacked right away so that the VM never has to
+// dereference (or cast) the object to do arithmetic with it
+obj::Value::Value(obj::obj_ptr object)
+    : kind(OBJECT), num(0), ref(std::move(object)) {
+  if (ref == nullptr) {
+    kind = EMPTY;
+    return;
+  }
+
+  switch (ref->_type()) {
+    case obj::INTEGER: {
+      kind = INT;
+      num = fast_cast<obj::Integer>(ref)->value;
+    } break;
+    case obj::BOOLEAN: {
+      kind = BOOL;
+      num = fast_cast<obj::Bool>(ref)->value;
+    } break;
+    default: {
+      if (ref == NONE_OBJ) {
+        kind = NONE;
+      }
+    }
+  }
+}
+
+obj::Value obj::Value::integer(int64_t num) {
+  Value v;
+  v.kind = INT;
+  v.num = num;
+  return v;
+}
+
+obj::Value obj::Value::boolean(bool b) {
+  Value v;
+  v.kind = BOOL;
+  v.num = b;
+  return v;
+}
+
+obj::Value obj::Value::none() {
+  Value v;
+  v.kind = NONE;
+  return v;
+}
+
+obj::obj_type obj::Value::type() const {
+  switch (kind) {
+    case INT:
+      return obj::INTEGER;
+    case BOOL:
+      return obj::BOOLEAN;
+    case NONE:
+      return obj::OPTION;
+    case OBJECT:
+      return ref->_type();
+    default:
+      return obj::ERROR;
+  }
+}
+
+obj::obj_ptr obj::Value::box() const {
+  if (ref != nullptr) {
+    return ref;
+  }
+
+  switch (kind) {
+    case INT:
+      return obj::make_integer(num);
+    case BOOL:
+      return num ? TRUE_OBJ : FALSE_OBJ;
+    case NONE:
+      return NONE_OBJ;
+    default:
+      return nullptr;
+  }
+}
@@ -0,0 +1,285 @@
+#include "vm.h"
+#include "compiler.h"
+#include "eval.h"
+
+namespace {
+
+obj::Value run_proto(const vm::Proto &proto, env::env_ptr envir);
+
+obj::obj_list box_values(obj::value_list::iterator begin,
+                         obj::value_list::iterator end) {
+  obj::obj_list boxed;
+  boxed.reserve(end - begin);
+  for (auto value = begin; value != end; value++) {
+    boxed.push_back(value->box());
+  }
+  return boxed;
+}
+
+// Numbers and bools are handled right here without boxing. Anything else goes
+// through the same helper eval() uses.
+obj::Value infix_values(const Token &op, const obj::Value &left,
+                        const obj::Value &right) {
+  TokenType type = op.get_type();
+
+  if (type == TokenType::DOUBLE_AMP) {
+    return obj::Value::boolean(valueTruthiness(left) &&
+                               valueTruthiness(right));
+  }
+  if (type == TokenType::DOUBLE_PIPE) {
+    return obj::Value::boolean(valueTruthiness(left) ||
+                               valueTruthiness(right));
+  }
+
+  if (left.is_int() && right.is_int() && type != TokenType::DOUBLE_DOT &&
+      type != TokenType::TRIPLE_DOT) {
+    return evalIntegerInfixValue(op, left.as_int(), right.as_int());
+  }
+
+  if (left.is_bool() && right.is_bool()) {
+    if (type == TokenType::EQ) {
+      return obj::Value::boolean(left.as_bool() == right.as_bool());
+    }
+    if (type == TokenType::NEQ) {
+      return obj::Value::boolean(left.as_bool() != right.as_bool());
+    }
+  }
+
+  return obj::Value(evalInfixOperator(op, left.box(), right.box()));
+}
+
+obj::Value prefix_value(const Token &op, const obj::Value &right) {
+  if (op.get_type() == TokenType::MINUS && right.is_int()) {
+    return obj::Value::integer(-1 * right.as_int());
+  }
+  if (op.get_type() == TokenType::BANG) {
+    return obj::Value::boolean(!valueTruthiness(right));
+  }
+  return obj::Value(evalPrefixOperator(op, right.box()));
+}
+
+// Calls straight into another proto keep their arguments unboxed. Builtins
+// (and functions made by eval) still get regular objects through
+// applyFunction.
+void init_var(const vm::VarRef &var, obj::Value value, env::env_ptr envir) {
+  if (var.slot < 0) {
+    envir->init(var.name, value);
+  } else {
+    envir->init(var.slot, var.name, value);
+  }
+}
+
+obj::Value call_values(const obj::Value &callable,
+                       obj::value_list::iterator args_begin,
+                       obj::value_list::iterator args_end) {
+  obj::obj_type callable_type = callable.type();
+  if (callable_type != obj::FUNCTION && callable_type != obj::BUILTIN) {
+    throw NoSuchOperatorException("No call operation on type " +
+                                  obj::type_to_string(callable_type));
+  }
+
+  if (callable_type == obj::FUNCTION) {
+    obj::func_ptr func_obj = fast_cast<obj::Function>(callable.object());
+    if (func_obj->proto != nullptr) {
+      ast::param_list &params = func_obj->func_node->params;
+      if (params.size() > static_cast<size_t>(args_end - args_begin)) {
+        throw InvalidArgsException("Incorrect number of args given");
+      }
+
+      env::env_ptr new_env = pool::make<env::Environment>(
+          func_obj->envir, func_obj->func_node->body->slot_count);
+      auto arg_value = args_begin;
+      for (auto param = params.begin(); param != params.end();
+           param++, arg_value++) {
+        bindIdent(*param, *arg_value, new_env);
+      }
+      sample::FrameGuard frame(*func_obj->func_node);
+      return run_proto(*func_obj->proto, new_env);
+    }
+  }
+
+  obj::obj_list args = box_values(args_begin, args_end);
+  return obj::Value(applyFunction(callable.box(), std::move(args)));
+}
+
+// The VM is a plain stack machine over tagged values. Every operator defers to
+// the same helpers that eval() uses once its operands are ready (unless both
+// are plain numbers or bools), so the only thing that differs between the two
+// is how we get to those operands.
+obj::Value run_proto(const vm::Proto &proto, env::env_ptr envir) {
+  using namespace vm;
+
+  obj::value_list stack;
+  stack.reserve(proto.max_stack);
+
+  const Instruction *code = proto.code.data();
+  size_t ip = 0;
+  sample::CallStack &calls = sample::call_stack();
+
+  while (true) {
+    const Instruction &ins = code[ip++];
+    switch (ins.op) {
+      case OP_CONSTANT: {
+        stack.push_back(proto.constants[ins.arg]);
+      } break;
+
+      case OP_TRUE: {
+        stack.push_back(obj::Value::boolean(true));
+      } break;
+
+      case OP_FALSE: {
+        stack.push_back(obj::Value::boolean(false));
+      } break;
+
+      case OP_NONE: {
+        stack.push_back(obj::Value::none());
+      } break;
+
+      case OP_POP: {
+        stack.pop_back();
+      } break;
+
+      case OP_GET_NAME: {
+        symbol_id name = proto.names[ins.arg];
+        obj::Value value = envir->get_value(name);
+        if (value.is_empty()) {
+          throw NoVarException(std::string(SymbolTable::name(name)));
+        }
+        stack.push_back(value);
+      } break;
+
+      case OP_SET_NAME: {
+        envir->set(proto.names[ins.arg], stack.back());
+      } break;
+
+      case OP_GET_VAR: {
+        const VarRef &var = proto.vars[ins.arg];
+        obj::Value value = envir->get_value(var.depth, var.slot);
+        if (value.is_empty()) {
+          value = envir->get_shadowed(var.name, var.shadows);
+          if (value.is_empty()) {
+            throw NoVarException(std::string(SymbolTable::name(var.name)));
+          }
+        }
+        stack.push_back(value);
+      } break;
+
+      case OP_SET_VAR: {
+        const VarRef &var = proto.vars[ins.arg];
+        envir->set(var.depth, var.slot, var.name, stack.back(), var.shadows);
+      } break;
+
+      case OP_LET: {
+        init_var(proto.vars[ins.arg], stack.back(), envir);
+      } break;
+
+      case OP_LET_OPTION: {
+        obj::opt_ptr opt = pool::make<obj::Option>(stack.back().box());
+        init_var(proto.vars[ins.arg], opt, envir);
+        stack.back() = obj::Value(opt);
+      } break;
+
+      case OP_LET_NONE: {
+        init_var(proto.vars[ins.arg], obj::Value::none(), envir);
+        stack.push_back(obj::Value::none());
+      } break;
+
+      case OP_INFIX: {
+        obj::Value right = stack.back();
+        stack.pop_back();
+        stack.back() = infix_values(proto.tokens[ins.arg], stack.back(), right);
+      } break;
+
+      case OP_PREFIX: {
+        stack.back() = prefix_value(proto.tokens[ins.arg], stack.back());
+      } break;
+
+      case OP_LIST: {
+        obj::obj_list elements = box_values(stack.end() - ins.arg, stack.end());
+        stack.resize(stack.size() - ins.arg);
+        stack.push_back(obj::Value(pool::make<obj::List>(elements)));
+      } break;
+
+      case OP_MAP: {
+        obj::obj_map pairs;
+        pairs.reserve(ins.arg);
+        auto kv = stack.end() - 2 * ins.arg;
+        for (; kv != stack.end(); kv += 2) {
+          insertMapPair(pairs, kv->box(), (kv + 1)->box());
+        }
+        stack.resize(stack.size() - 2 * ins.arg);
+        stack.push_back(obj::Value(pool::make<obj::Map>(std::move(pairs))));
+      } break;
+
+      case OP_INDEX: {
+        obj::obj_ptr index = stack.back().box();
+        stack.pop_back();
+        stack.back() =
+            obj::Value(evalIndexOperator(stack.back().box(), index));
+      } break;
+
+      case OP_INDEX_SET: {
+        obj::obj_ptr value = stack.back().box();
+        stack.pop_back();
+        obj::obj_ptr index = stack.back().box();
+        stack.pop_back();
+        stack.back() = obj::Value(
+            evalIndexAssignOperator(stack.back().box(), index, value));
+      } break;
+
+      case OP_WRAP_OPTION: {
+        stack.back() =
+            obj::Value(pool::make<obj::Option>(stack.back().box()));
+      } break;
+
+      case OP_JUMP: {
+        ip = ins.arg;
+      } break;
+
+      case OP_JUMP_IF_FALSE: {
+        bool condition = valueTruthiness(stack.back());
+        stack.pop_back();
+        if (!condition) {
+          ip = ins.arg;
+        }
+      } break;
+
+      case OP_CLOSURE: {
+        stack.push_back(obj::Value(pool::make<obj::Function>(
+            proto.functions[ins.arg], envir, proto.protos[ins.arg])));
+      } break;
+
+      case OP_LINE: {
+        calls.at_line(ins.arg);
+      } break;
+
+      case OP_CALL: {
+        auto args_begin = stack.end() - ins.arg;
+        obj::Value result =
+            call_values(*(args_begin - 1), args_begin, stack.end());
+        stack.resize(stack.size() - ins.arg);
+        stack.back() = result;
+      } break;
+
+      case OP_RETURN: {
+        obj::Value result = stack.back();
+        if (proto.is_script && ins.arg) {
+          return obj::Value(pool::make<obj::ReturnVal>(result.box()));
+        }
+        return result;
+      } break;
+    }
+  }
+}
+
+}  // namespace
+
+obj::obj_ptr vm::run(ast::block_ptr program, env::env_ptr envir) {
+  Compiler compiler = Compiler();
+  proto_ptr proto = compiler.compile_program(program);
+  return execute(*proto, envir);
+}
+
+obj::obj_ptr vm::execute(const Proto &proto, env::env_ptr envir) {
+  return run_proto(proto, envir).box();
+}
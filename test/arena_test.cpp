@@ -0,0 +1,60 @@
+#include "arena.h"
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "alloc_stats.h"
+#include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+
+TEST(Arena, Alignment) {
+  ast::Arena arena;
+  arena.allocate(1, 1);
+  void *aligned = arena.allocate(sizeof(int64_t), alignof(int64_t));
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(aligned) % alignof(int64_t), 0u);
+
+  arena.allocate(100000, 8);
+  ASSERT_EQ(arena.chunk_count(), 2u) << "Big allocations get their own chunk";
+}
+
+TEST(Arena, FewChunksPerProgram) {
+  std::string input;
+  for (int i = 0; i < 200; i++) {
+    input += "let x" + std::to_string(i) + " = [1, 2 + 3, \"four\"]\n";
+  }
+
+  auto parse = [&]() {
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(&lexer);
+    ast::block_ptr program = parser.parse_program();
+    return parser.get_arena();
+  };
+  // The first parse also interns every name, which is a one time cost
+  parse();
+
+  stats::Allocations before = stats::allocations();
+  ast::arena_ptr arena = parse();
+  uint64_t allocs = (stats::allocations() - before).allocs;
+
+  // Eight nodes a line, of which the list and the string still allocate
+  // (see arena.h)
+  ASSERT_GE(arena->allocation_count(), 200u * 8)
+      << "Every node should be allocated in the arena";
+  ASSERT_LT(arena->chunk_count(), 10u);
+  ASSERT_LT(allocs, 200u * 4) << "Nodes shouldn't be allocated one by one";
+}
+
+TEST(Arena, NodesKeepTheArenaAlive) {
+  ast::node_ptr first;
+  {
+    Lexer lexer = Lexer("let f = (a) => { a }");
+    Parser parser = Parser(&lexer);
+    first = parser.parse_program()->nodes.front();
+  }
+
+  // Both the parser and the program are gone by now
+  ASSERT_EQ(first->_type(), ast::LET);
+  auto let = std::dynamic_pointer_cast<ast::Let>(first);
+  ASSERT_EQ(let->expression->_type(), ast::FUNCTION);
+}
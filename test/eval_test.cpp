@@ -1,10 +1,14 @@
 #include "eval.h"
 #include <gtest/gtest.h>
 #include <memory>
+#include <thread>
+#include "alloc_stats.h"
 #include "ast.h"
+#include "builtin.h"
 #include "lexer.h"
 #include "object.h"
 #include "parser.h"
+#include "thread_pool.h"
 
 obj::obj_ptr test_eval(const std::string &input) {
   Lexer lexer = Lexer(input);
@@ -14,6 +18,14 @@ obj::obj_ptr test_eval(const std::string &input) {
   return eval(program, envir);
 }
 
+// Makes pmap spread its calls over a pool of its own for as long as it's
+// around, so they run on several threads on any machine (see builtin.h)
+struct ForcedPmapPool {
+  ThreadPool pool;
+  ForcedPmapPool() : pool(4) { set_pmap_pool(&pool); }
+  ~ForcedPmapPool() { set_pmap_pool(nullptr); }
+};
+
 // No need to test the minus op separately
 TEST(Eval, IntEval) {
   struct test_suite {
@@ -111,4 +123,256 @@ TEST(Eval, OptionEval) {
   std::string input = "let opt? = 5";
 
   std::cout << "Testing eval of " << input << std::endl;
-}
\ No newline at end of file
+}
+
+TEST(Eval, SmallIntsAreShared) {
+  ASSERT_EQ(test_eval("5"), test_eval("2 + 3"))
+      << "Small integers should come from the cache";
+  ASSERT_EQ(obj::make_integer(SMALL_INT_MIN), obj::make_integer(SMALL_INT_MIN));
+  ASSERT_NE(obj::make_integer(SMALL_INT_MAX + 1),
+            obj::make_integer(SMALL_INT_MAX + 1))
+      << "Integers outside the cache are still allocated";
+
+  Lexer lexer = Lexer("(a) => { 5000 }");
+  Parser parser = Parser(&lexer);
+  ast::block_ptr program = parser.parse_program();
+  auto func = std::dynamic_pointer_cast<ast::Function>(program->nodes[0]);
+  auto literal = std::dynamic_pointer_cast<ast::Integer>(func->body->nodes[0]);
+  ASSERT_EQ(literal->constant->value, 5000);
+  env::env_ptr envir = env::env_ptr(new env::Environment());
+  ASSERT_EQ(eval(literal, envir), literal->constant)
+      << "Literals should evaluate to the object made at parse time";
+}
+
+TEST(Eval, MapKeysByValue) {
+  struct test_suite {
+    std::string input;
+    int64_t expected;
+  };
+
+  test_suite tests[] = {
+      {"let m = {[1, 2]: 3}\nm[[1, 2]]", 3},
+      {"let m = {\"a\": 1, \"a\": 2}\nlen(m)", 1},
+      {"let m = {1: 1}\nm[2] = 5\nm[2] + len(m)", 7},
+      {"let m = {1..3: 4}\nm[1..3]", 4},
+      {"let m = {{1: 2}: 6}\nm[{1: 2}]", 6},
+  };
+
+  int iterations = sizeof(tests) / sizeof(tests[0]);
+  for (int i = 0; i < iterations; i++) {
+    obj::obj_ptr eval_obj = test_eval(tests[i].input);
+    ASSERT_EQ(eval_obj->_type(), obj::INTEGER) << "Failed on test " << i + 1;
+    ASSERT_EQ(fast_cast<obj::Integer>(eval_obj)->value, tests[i].expected)
+        << "Failed on test " << i + 1;
+  }
+}
+
+TEST(Eval, MapPrintsInInsertionOrder) {
+  obj::obj_ptr map_obj = test_eval("{\"z\": 1, \"a\": 2, 10: 3, \"m\": 4}");
+  ASSERT_EQ(map_obj->print(), "{ z: 1, a: 2, 10: 3, m: 4 }");
+
+  obj::obj_ptr keys = test_eval(
+      "let m = {3: 0, 1: 0, 2: 0}\nm[0] = 0\nmap(m, (k, v, i) => { k * i })");
+  ASSERT_EQ(keys->print(), "[ 0, 1, 4, 0 ]");
+}
+
+TEST(Eval, ContainerHashesFollowChanges) {
+  obj::obj_ptr result = test_eval(
+      "let l = [1, 2]\n"
+      "let before = hash(l)\n"
+      "let again = hash(l)\n"
+      "l[0] = 5\n"
+      "[before == again, before == hash(l), l[0]]");
+  ASSERT_EQ(result->print(), "[ true, false, 5 ]");
+
+  // Changing a list inside another one has to reach the outer hash too
+  result = test_eval(
+      "let inner = [1]\n"
+      "let outer = {\"k\": [inner]}\n"
+      "let wrapped? = outer\n"
+      "let before = [hash(outer), hash(wrapped)]\n"
+      "inner[0] = 2\n"
+      "[before[0] == hash(outer), before[1] == hash(wrapped)]");
+  ASSERT_EQ(result->print(), "[ false, false ]");
+
+  result = test_eval(
+      "let m = {1: 1}\n"
+      "let before = hash(m)\n"
+      "m[2] = 2\n"
+      "before == hash(m)");
+  ASSERT_EQ(result->print(), "false");
+
+  // Even when the change is made on another thread
+  ForcedPmapPool forced;
+  result = test_eval(
+      "let inner = [1]\n"
+      "let outer = [inner]\n"
+      "let before = hash(outer)\n"
+      "pmap(1..2, (x) => { if (x == 2) { inner[0] = 2 } })\n"
+      "before == hash(outer)");
+  ASSERT_EQ(result->print(), "false");
+}
+
+TEST(Eval, StringConcatenation) {
+  obj::obj_ptr result = test_eval(
+      "let s = \"\"\n"
+      "each(1..100000, (x) => { s = s + \"abcdefgh\" })\n"
+      "[len(s), s[0], s[799999], s == s + \"\"]");
+  ASSERT_EQ(result->print(), "[ 800000, a, h, true ]");
+
+  obj::str_ptr left = obj::str_ptr(new obj::String(std::string(100, 'a')));
+  obj::str_ptr right = obj::str_ptr(new obj::String(std::string(100, 'b')));
+  obj::str_ptr joined = obj::String::concat(left, right);
+  ASSERT_EQ(joined->size(), 200u);
+  ASSERT_EQ(joined->get_value(), std::string(100, 'a') + std::string(100, 'b'));
+  ASSERT_EQ(joined->hash(), obj::String(joined->get_value()).hash())
+      << "A rope hashes the same as the flat string";
+}
+
+TEST(Eval, CharactersAreShared) {
+  ASSERT_EQ(test_eval("\"abc\"[1]"), test_eval("\"xbz\"[1]"))
+      << "Single characters should come from the cache";
+  ASSERT_EQ(test_eval("\"abc\"[2]"), obj::make_char('c'));
+  ASSERT_EQ(obj::make_char('\xff')->get_value(), "\xff");
+
+  obj::obj_ptr chars = test_eval("map(\"hello\", (c) => { c })");
+  obj::arr_ptr list = fast_cast<obj::List>(chars);
+  ASSERT_EQ(list->values[2], list->values[3]);
+  ASSERT_EQ(chars->print(), "[ h, e, l, l, o ]");
+}
+
+TEST(Eval, ParallelMap) {
+  struct test_suite {
+    std::string input;
+    std::string expected;
+  };
+
+  test_suite tests[] = {
+      {"pmap([1, 2, 3], (x, i) => { x * 10 + i })", "[ 10, 21, 32 ]"},
+      {"pmap(3..1, (x, i) => { x * 10 + i })", "[ 30, 21, 12 ]"},
+      {"pmap(\"abc\", (c, i) => { c + c })", "[ aa, bb, cc ]"},
+      {"pmap({1: 2, 3: 4}, (k, v, i) => { k + v + i })", "[ 3, 8 ]"},
+      {"pmap([], (x) => { x })", "[  ]"},
+      {"let base = 5\npmap(1..3, (x) => { x + base })", "[ 6, 7, 8 ]"},
+      // Big enough to be split up, and the order still has to hold
+      {"let f = (x) => { x * x }\n"
+       "hash(pmap(1..5000, f)) == hash(map(1..5000, f))",
+       "true"},
+      {"pmap(1..2000, (x) => { x * 2 })[1999]", "4000"},
+      // Every call flattens (and hashes) the same rope at once
+      {"let a = \"abcdefghijklmnopqrstuvwxyzabcdefghijklmnopqrstuvwxyz\"\n"
+       "let m = {a + a: 1}\n"
+       "let s = a + a\n"
+       "len(pmap(1..2000, (x) => { m[s] }))",
+       "2000"},
+      {"pmap(1..5000, len)", "ERROR"},
+  };
+
+  auto check = [&]() {
+    int iterations = sizeof(tests) / sizeof(tests[0]);
+    for (int i = 0; i < iterations; i++) {
+      if (tests[i].expected == "ERROR") {
+        ASSERT_ANY_THROW(test_eval(tests[i].input))
+            << "Failed on test " << i + 1;
+        continue;
+      }
+      obj::obj_ptr eval_obj = test_eval(tests[i].input);
+      ASSERT_EQ(eval_obj->print(), tests[i].expected)
+          << "Failed on test " << i + 1;
+    }
+  };
+
+  // Once as this machine would run them, and once on several threads, even if
+  // it only has the one core
+  check();
+  ForcedPmapPool forced;
+  check();
+}
+
+TEST(Eval, ObjectStats) {
+  // Well past the shared small integers, so every one is a new object. Those
+  // are made the first time any integer is, so that's out of the way first.
+  obj::make_integer(0);
+  stats::KindStats before = stats::objects_of("INTEGER");
+  {
+    obj::obj_list ints;
+    for (int i = 0; i < 100; i++) {
+      ints.push_back(obj::make_integer(100000 + i));
+    }
+    stats::KindStats during = stats::objects_of("INTEGER");
+    ASSERT_EQ(during.allocs - before.allocs, 100u);
+    ASSERT_EQ(during.live_bytes - before.live_bytes,
+              100 * sizeof(obj::Integer));
+    ASSERT_GE(during.peak_bytes, during.live_bytes);
+  }
+  stats::KindStats after = stats::objects_of("INTEGER");
+  ASSERT_EQ(after.frees - before.frees, 100u);
+  ASSERT_EQ(after.live_bytes, before.live_bytes);
+
+  // Arithmetic stays unboxed until something needs it as an object. Every
+  // literal is a shared small integer, so parsing doesn't make any either.
+  uint64_t ints = stats::objects_of("INTEGER").allocs;
+  obj::obj_ptr arithmetic = test_eval(
+      "let a = 1000\n"
+      "let b = a * 3 + -(a * 5) - 7\n"
+      "let f = (n) => { n * 2 > 1000 }\n"
+      "if (f(b * b)) { b < 0 } else { false }\n"
+      "f(b - 1)");
+  ASSERT_EQ(arithmetic->print(), "false");
+  ASSERT_EQ(stats::objects_of("INTEGER").allocs, ints);
+
+  // Flattening a rope doesn't make any strings of its own
+  obj::str_ptr rope = obj::String::concat(
+      pool::make<obj::String>(std::string(100, 'a')),
+      pool::make<obj::String>(std::string(100, 'b')));
+  stats::KindStats strings = stats::objects_of("STRING");
+  rope->get_value();
+  ASSERT_EQ(stats::objects_of("STRING").allocs, strings.allocs);
+
+  // Counts are kept per thread, but still add up once the thread is gone
+  std::thread worker([]() {
+    for (int i = 0; i < 100; i++) {
+      obj::make_integer(100000 + i);
+    }
+  });
+  worker.join();
+  stats::KindStats joined = stats::objects_of("INTEGER");
+  ASSERT_EQ(joined.allocs - after.allocs, 100u);
+  ASSERT_EQ(joined.frees - after.frees, 100u);
+
+  // Every call makes an environment
+  uint64_t envs = stats::objects_of("ENVIRONMENT").allocs;
+  test_eval("let f = (x) => { x }\nf(1)\nf(2)");
+  ASSERT_GE(stats::objects_of("ENVIRONMENT").allocs - envs, 3u);
+
+  obj::obj_ptr result = test_eval(
+      "let f = (x) => { x }\nf(1)\n"
+      "let s = stats()\ns[\"ENVIRONMENT\"][\"allocs\"] > 0");
+  ASSERT_EQ(result->print(), "true");
+  ASSERT_ANY_THROW(test_eval("stats(1)"));
+}
+
+TEST(Eval, RangeEval) {
+  struct test_suite {
+    std::string input;
+    std::string expected;
+  };
+
+  test_suite tests[] = {
+      {"[len(1..5), len(5..1), len(1...5), len(5...1), len(3...3)]",
+       "[ 5, 5, 4, 4, 1 ]"},
+      {"let r = 10..20\n[r[0], r[10], r[11]]", "[ 10, 20, NONE ]"},
+      {"let r = 5..1\n[r[0], r[4]]", "[ 5, 1 ]"},
+      {"len(0..(100000 * 100000))", "10000000001"},
+      {"hash(2..9) == hash(2...10)", "true"},
+      {"map(3..1, (x, i) => { x * 10 + i })", "[ 30, 21, 12 ]"},
+      {"let m = {1..3: 7}\nm[1..3]", "7"},
+  };
+
+  int iterations = sizeof(tests) / sizeof(tests[0]);
+  for (int i = 0; i < iterations; i++) {
+    obj::obj_ptr eval_obj = test_eval(tests[i].input);
+    ASSERT_EQ(eval_obj->print(), tests[i].expected)
+        << "Failed on test " << i + 1;
+  }
+}
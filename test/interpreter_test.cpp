@@ -0,0 +1,170 @@
+#include "interpreter.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <thread>
+#include <vector>
+#include "alloc_stats.h"
+#include "eval.h"
+#include "parth_error.h"
+
+TEST(Interpreter, GlobalsOutliveARun) {
+  Interpreter interpreter;
+  interpreter.run("let total = 10");
+  obj::obj_ptr result = interpreter.run("total = total + 5\ntotal * 2");
+  ASSERT_EQ(result->print(), "30");
+}
+
+TEST(Interpreter, KeepsToItself) {
+  Interpreter first;
+  Interpreter second;
+  first.run("let x = 1");
+  ASSERT_THROW(second.run("x"), NoVarException);
+  second.run("let x = 2");
+  ASSERT_EQ(first.run("x")->print(), "1");
+}
+
+TEST(Interpreter, ErrorsCarryTheirMessage) {
+  Interpreter interpreter;
+  interpreter.run("let x = 1");
+  try {
+    interpreter.run("let x = 2");
+    FAIL() << "Expected the second let to throw";
+  } catch (const InitVarException &e) {
+    ASSERT_STREQ(e.what(), "Variable x already exists in top scope");
+  }
+}
+
+TEST(Interpreter, CompileOnceRunMany) {
+  for (bool use_vm : {false, true}) {
+    program_ptr program = Program::compile("let y = x * 2\ny + offset", use_vm);
+    ASSERT_EQ(program->uses_vm(), use_vm);
+
+    Interpreter interpreter;
+    interpreter.bind("offset", obj::Value::integer(100));
+    for (int i = 0; i < 50; i++) {
+      obj::obj_ptr result =
+          interpreter.execute(program, {{"x", obj::Value::integer(i)}});
+      // The `let` would throw if the last run's y were still around
+      ASSERT_EQ(result->print(), std::to_string(i * 2 + 100))
+          << "Run " << i << (use_vm ? " on the VM" : "");
+    }
+  }
+}
+
+TEST(Interpreter, RunsLeaveTheGlobalsAlone) {
+  Interpreter interpreter;
+  interpreter.run("let total = 1");
+  program_ptr program = Program::compile("let local = total + n\nlocal");
+  interpreter.execute(program, {{"n", obj::Value::integer(5)}});
+  ASSERT_THROW(interpreter.run("local"), NoVarException);
+  ASSERT_EQ(interpreter.run("total")->print(), "1");
+}
+
+// A function that outlives its run keeps the values that run was given, even
+// after later runs with other inputs
+TEST(Interpreter, ClosuresKeepTheirRun) {
+  Interpreter interpreter;
+  program_ptr program = Program::compile("() => { x }");
+  obj::obj_ptr first =
+      interpreter.execute(program, {{"x", obj::Value::integer(1)}});
+  obj::obj_ptr second =
+      interpreter.execute(program, {{"x", obj::Value::integer(2)}});
+  interpreter.execute(program, {{"x", obj::Value::integer(3)}});
+
+  ASSERT_EQ(applyFunction(first, obj::obj_list())->print(), "1");
+  ASSERT_EQ(applyFunction(second, obj::obj_list())->print(), "2");
+
+  // Including what the run declared, like a helper or the function itself
+  for (bool use_vm : {false, true}) {
+    program_ptr helped = Program::compile(
+        "let twice = (x) => { x * 2 }\n(y) => { twice(y) + k }", use_vm);
+    obj::obj_ptr add =
+        interpreter.execute(helped, {{"k", obj::Value::integer(1)}});
+    interpreter.execute(helped, {{"k", obj::Value::integer(5)}});
+    obj::obj_list args{obj::make_integer(3)};
+    ASSERT_EQ(applyFunction(add, args)->print(), "7");
+
+    program_ptr recursive = Program::compile(
+        "let f = (n) => { if (n < 1) { return 0 }\n n + f(n - 1) }\n[f]",
+        use_vm);
+    obj::obj_ptr list = interpreter.execute(recursive, {});
+    obj::obj_ptr f = fast_cast<obj::List>(list)->values[0];
+    args = {obj::make_integer(4)};
+    ASSERT_EQ(applyFunction(f, args)->print(), "10");
+  }
+}
+
+// A top-level function and the scope it's declared in hold each other, which
+// mustn't keep either of them around once the run is over
+TEST(Interpreter, RunsDontLeak) {
+  for (bool use_vm : {false, true}) {
+    program_ptr program =
+        Program::compile("let f = (x) => { x + base }\nf(1)", use_vm);
+    Interpreter interpreter;
+    interpreter.bind("base", obj::Value::integer(10));
+    // The first run makes the scope that every later one reuses
+    interpreter.execute(program, bindings());
+
+    stats::KindStats funcs = stats::objects_of("FUNCTION");
+    stats::KindStats envs = stats::objects_of("ENVIRONMENT");
+    for (int i = 0; i < 1000; i++) {
+      ASSERT_EQ(interpreter.execute(program, bindings())->print(), "11");
+    }
+    stats::KindStats funcs_after = stats::objects_of("FUNCTION");
+    stats::KindStats envs_after = stats::objects_of("ENVIRONMENT");
+    ASSERT_EQ(funcs_after.allocs - funcs.allocs, 1000u);
+    ASSERT_EQ(funcs_after.allocs - funcs.allocs,
+              funcs_after.frees - funcs.frees)
+        << (use_vm ? "On the VM" : "");
+    ASSERT_EQ(envs_after.allocs - envs.allocs, envs_after.frees - envs.frees)
+        << (use_vm ? "On the VM" : "");
+  }
+}
+
+static obj::obj_ptr host_double(const obj::obj_list &args) {
+  int64_t value = fast_cast<obj::Integer>(args[0])->value;
+  return obj::make_integer(value * 2);
+}
+
+TEST(Interpreter, HostBuiltins) {
+  Interpreter interpreter;
+  interpreter.bind("double",
+                   obj::builtin_ptr(new obj::Builtin(&host_double)));
+  program_ptr program = Program::compile("map(items, double)");
+  obj::arr_ptr items = obj::arr_ptr(new obj::List(
+      {obj::make_integer(1), obj::make_integer(2), obj::make_integer(3)}));
+  obj::obj_ptr result = interpreter.execute(program, {{"items", items}});
+  ASSERT_EQ(result->print(), "[ 2, 4, 6 ]");
+}
+
+// Each thread gets its own interpreter and its own numbers, so any state
+// leaking between them would show up in the results
+TEST(Interpreter, OnePerThread) {
+  const int threads = 4;
+  // One program for all of them, which they can share since it never changes
+  program_ptr program = Program::compile(
+      "let fib = (n) => {\nif (n < 2) { return n }\n"
+      "fib(n - 1) + fib(n - 2)\n}\n"
+      "let words = {}\n"
+      "each(1..200, (i) => { words[i % 7] = i + base })\n"
+      "fib(15) + words[3]");
+
+  std::vector<std::string> results(threads);
+  std::vector<std::thread> workers;
+  for (int t = 0; t < threads; t++) {
+    workers.emplace_back([t, &program, &results]() {
+      Interpreter interpreter;
+      results[t] =
+          interpreter.execute(program, {{"base", obj::Value::integer(t)}})
+              ->print();
+    });
+  }
+  for (auto &worker : workers) {
+    worker.join();
+  }
+
+  for (int t = 0; t < threads; t++) {
+    // fib(15) is 610, and the last i with i % 7 == 3 is 199
+    ASSERT_EQ(results[t], std::to_string(610 + 199 + t)) << "Thread " << t;
+  }
+}
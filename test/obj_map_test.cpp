@@ -0,0 +1,80 @@
+#include "obj_map.h"
+#include <gtest/gtest.h>
+#include <string>
+#include "object.h"
+
+namespace {
+
+// Every one of these hashes the same, but they're only equal to themselves
+class Colliding : public obj::Object {
+ public:
+  std::string print() { return "COLLIDING"; }
+  std::string inspect() { return "COLLIDING"; }
+  uint64_t hash() { return 42; }
+  obj::obj_type _type() { return obj::ERROR; }
+};
+
+}  // namespace
+
+TEST(ObjMap, InsertAndFind) {
+  obj::ObjMap map;
+  for (int64_t i = 0; i < 1000; i++) {
+    map.insert(obj::make_integer(i), obj::make_integer(i * 2));
+  }
+  ASSERT_EQ(map.size(), 1000u);
+
+  for (int64_t i = 0; i < 1000; i++) {
+    const obj::obj_ptr *found = map.find(obj::make_integer(i));
+    ASSERT_NE(found, nullptr) << "Missing key " << i;
+    ASSERT_EQ(fast_cast<obj::Integer>(*found)->value, i * 2);
+  }
+  ASSERT_EQ(map.find(obj::make_integer(1000)), nullptr);
+
+  size_t seen = 0;
+  for (const auto &entry : map) {
+    ASSERT_EQ(entry.hash, entry.key->hash());
+    seen++;
+  }
+  ASSERT_EQ(seen, 1000u);
+}
+
+TEST(ObjMap, EqualKeysReplace) {
+  obj::ObjMap map;
+  map.insert(obj::str_ptr(new obj::String("key")), obj::make_integer(1));
+  map.insert(obj::str_ptr(new obj::String("key")), obj::make_integer(2));
+  ASSERT_EQ(map.size(), 1u);
+
+  const obj::obj_ptr *found = map.find(obj::str_ptr(new obj::String("key")));
+  ASSERT_NE(found, nullptr);
+  ASSERT_EQ(fast_cast<obj::Integer>(*found)->value, 2);
+}
+
+TEST(ObjMap, CollidingKeysStayApart) {
+  obj::obj_ptr first = obj::obj_ptr(new Colliding());
+  obj::obj_ptr second = obj::obj_ptr(new Colliding());
+
+  obj::ObjMap map;
+  map.insert(first, obj::make_integer(1));
+  map.insert(second, obj::make_integer(2));
+  ASSERT_EQ(map.size(), 2u) << "A shared hash shouldn't overwrite";
+  ASSERT_EQ(fast_cast<obj::Integer>(*map.find(first))->value, 1);
+  ASSERT_EQ(fast_cast<obj::Integer>(*map.find(second))->value, 2);
+  ASSERT_EQ(map.find(obj::obj_ptr(new Colliding())), nullptr);
+}
+
+TEST(ObjMap, KeepsInsertionOrder) {
+  obj::ObjMap map;
+  int64_t keys[] = {50, 3, 700, -2, 9, 1000000};
+  for (int64_t key : keys) {
+    map.insert(obj::make_integer(key), obj::make_integer(0));
+  }
+  // Replacing a value doesn't move its key
+  map.insert(obj::make_integer(3), obj::make_integer(1));
+
+  size_t i = 0;
+  for (const auto &entry : map) {
+    ASSERT_EQ(fast_cast<obj::Integer>(entry.key)->value, keys[i]);
+    i++;
+  }
+  ASSERT_EQ(fast_cast<obj::Integer>(map.entry_at(1).value)->value, 1);
+}
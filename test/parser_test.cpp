@@ -152,4 +152,24 @@ TEST(Parser, InfixTests) {
     ASSERT_EQ(infix_node->to_string(), cur_test.to_string);
     ASSERT_EQ(infix_node->op.get_literal(), cur_test.op);
   }
-}
\ No newline at end of file
+}
+// Errors
+
+TEST(Parser, ErrorsCarryTheirMessage) {
+  try {
+    get_first_expression("let 5 = 3");
+    FAIL() << "Expected a let without a name to throw";
+  } catch (const UnexpectedException &e) {
+    ASSERT_STREQ(e.what(),
+                 "Unexpected token \"=\" at line 1, col 6; Expected IDENT");
+  }
+
+  try {
+    get_first_expression("let x = )");
+    FAIL() << "Expected a stray paren to throw";
+  } catch (const NoPrefixException &e) {
+    ASSERT_STREQ(e.what(),
+                 "Can't start an expression with RPAREN \")\" at line 1, "
+                 "col 8");
+  }
+}
@@ -0,0 +1,80 @@
+#include "pool.h"
+#include <gtest/gtest.h>
+#include <thread>
+#include <vector>
+#include "alloc_stats.h"
+#include "environment.h"
+#include "object.h"
+
+// The block an Integer and its refcount take together (with libstdc++, the
+// refcount comes first and is two counts and a vtable pointer)
+static const size_t INT_BLOCK = sizeof(obj::Integer) + 16;
+
+TEST(Pool, OneAllocationPerObject) {
+  // Nothing of that size waiting, so it has to come from the heap
+  std::vector<void *> taken;
+  while (pool::free_count(INT_BLOCK) > 0) {
+    taken.push_back(pool::take(INT_BLOCK));
+  }
+
+  stats::Allocations before = stats::allocations();
+  obj::int_ptr num = pool::make<obj::Integer>(123456);
+  ASSERT_EQ((stats::allocations() - before).allocs, 1u)
+      << "The refcount should share the object's block";
+
+  for (void *block : taken) {
+    pool::give(block, INT_BLOCK);
+  }
+}
+
+TEST(Pool, RecyclesFreedBlocks) {
+  obj::Integer *first = pool::make<obj::Integer>(123456).get();
+  size_t waiting = pool::free_count(INT_BLOCK);
+
+  stats::Allocations before = stats::allocations();
+  obj::int_ptr second = pool::make<obj::Integer>(654321);
+  ASSERT_EQ((stats::allocations() - before).allocs, 0u);
+  ASSERT_EQ(second.get(), first) << "The block just freed is the first reused";
+  ASSERT_EQ(pool::free_count(INT_BLOCK), waiting - 1);
+
+  // Things of a size share blocks, whatever their type
+  void *block = pool::take(40);
+  pool::give(block, 40);
+  ASSERT_EQ(pool::take(33), block);
+  pool::give(block, 33);
+}
+
+TEST(Pool, KeepsAtMostMaxFree) {
+  std::vector<void *> blocks;
+  for (size_t i = 0; i < pool::MAX_FREE + 10; i++) {
+    blocks.push_back(pool::take(200));
+  }
+  for (void *block : blocks) {
+    pool::give(block, 200);
+  }
+  ASSERT_EQ(pool::free_count(200), pool::MAX_FREE);
+}
+
+TEST(Pool, FreedOnAnotherThread) {
+  std::vector<obj::obj_ptr> made;
+  std::thread worker([&made]() {
+    for (int i = 0; i < 100; i++) {
+      made.push_back(pool::make<obj::Range>(i, i + 10));
+    }
+    env::env_ptr scratch = pool::make<env::Environment>();
+  });
+  worker.join();
+
+  // Out of the way, so the list has room for all of them
+  size_t size = sizeof(obj::Range) + 16;
+  std::vector<void *> taken;
+  while (pool::free_count(size) > 0) {
+    taken.push_back(pool::take(size));
+  }
+  made.clear();
+  ASSERT_EQ(pool::free_count(size), 100u);
+
+  for (void *block : taken) {
+    pool::give(block, size);
+  }
+}
@@ -0,0 +1,77 @@
+#include "profile.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "interpreter.h"
+
+// The count column of the first line of the report that starts with the label
+static std::string count_for(const std::string &report,
+                             const std::string &label) {
+  std::istringstream lines(report);
+  std::string line;
+  while (std::getline(lines, line)) {
+    if (line.compare(0, label.size() + 1, label + " ") == 0) {
+      std::istringstream fields(line);
+      std::string name, count;
+      fields >> name >> count;
+      return count;
+    }
+  }
+  return "";
+}
+
+TEST(Profile, CountsNodesAndCalls) {
+  if (!prof::ENABLED) {
+    GTEST_SKIP() << "Built without PROFILE=1";
+  }
+  prof::reset();
+
+  Interpreter interpreter;
+  interpreter.run("let f = (n) => { n + 1 }\nlen(map(1..10, f))");
+
+  std::ostringstream flat;
+  prof::report_flat(flat);
+  // The whole program is a block, and f's body is one for each call
+  ASSERT_EQ(count_for(flat.str(), "BLOCK"), "11");
+  ASSERT_EQ(count_for(flat.str(), "FUNCTION"), "1");
+  ASSERT_EQ(count_for(flat.str(), "fn@1:8"), "10");
+  ASSERT_EQ(count_for(flat.str(), "map"), "1");
+  ASSERT_EQ(count_for(flat.str(), "len"), "1");
+
+  std::ostringstream collapsed;
+  prof::report_collapsed(collapsed);
+  ASSERT_NE(collapsed.str().find("main;map;fn@1:8 "), std::string::npos)
+      << collapsed.str();
+}
+
+TEST(Profile, RecursionCountsTotalTimeOnce) {
+  if (!prof::ENABLED) {
+    GTEST_SKIP() << "Built without PROFILE=1";
+  }
+  prof::reset();
+
+  Interpreter interpreter;
+  interpreter.run(
+      "let fib = (n) => {\nif (n < 2) { return n }\n"
+      "fib(n - 1) + fib(n - 2)\n}\nfib(12)");
+
+  std::ostringstream flat;
+  prof::report_flat(flat);
+  std::istringstream lines(flat.str());
+  std::string line;
+  bool found = false;
+  while (std::getline(lines, line)) {
+    if (line.compare(0, 3, "fn@") != 0) continue;
+    std::istringstream fields(line);
+    std::string name;
+    uint64_t calls;
+    double self_ms, total_ms;
+    fields >> name >> calls >> self_ms >> total_ms;
+    ASSERT_EQ(calls, 465u);
+    // Nested calls don't add to the total again, so it can't be more than
+    // the time spent in all of them
+    ASSERT_LE(total_ms, self_ms * 1.01 + 0.01);
+    found = true;
+  }
+  ASSERT_TRUE(found) << flat.str();
+}
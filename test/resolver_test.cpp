@@ -0,0 +1,122 @@
+#include "resolver.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include "ast.h"
+#include "environment.h"
+#include "eval.h"
+#include "interpreter.h"
+#include "lexer.h"
+#include "parser.h"
+
+// parse_program() already runs the resolver
+ast::block_ptr resolve_input(const std::string &input) {
+  Lexer lexer = Lexer(input);
+  Parser parser = Parser(&lexer);
+  return parser.parse_program();
+}
+
+ast::func_ptr first_function(ast::block_ptr program) {
+  auto let = std::dynamic_pointer_cast<ast::Let>(program->nodes[0]);
+  return std::dynamic_pointer_cast<ast::Function>(let->expression);
+}
+
+TEST(Resolver, GlobalsStayByName) {
+  ast::block_ptr program = resolve_input("let x = 5\nx");
+  auto let = std::dynamic_pointer_cast<ast::Let>(program->nodes[0]);
+  auto ident = std::dynamic_pointer_cast<ast::Identifier>(program->nodes[1]);
+
+  ASSERT_EQ(let->name->slot, -1);
+  ASSERT_EQ(ident->slot, -1);
+  ASSERT_EQ(program->slot_count, 0u);
+}
+
+TEST(Resolver, ParamsAndLocals) {
+  ast::block_ptr program =
+      resolve_input("let f = (a, b) => {\nlet c = a\nc + b\n}");
+  ast::func_ptr f = first_function(program);
+
+  ASSERT_EQ(f->params[0]->slot, 0);
+  ASSERT_EQ(f->params[1]->slot, 1);
+  ASSERT_EQ(f->body->slot_count, 3u);
+
+  auto let = std::dynamic_pointer_cast<ast::Let>(f->body->nodes[0]);
+  ASSERT_EQ(let->name->slot, 2);
+  auto a = std::dynamic_pointer_cast<ast::Identifier>(let->expression);
+  ASSERT_EQ(a->depth, 0);
+  ASSERT_EQ(a->slot, 0);
+}
+
+TEST(Resolver, Closures) {
+  ast::block_ptr program = resolve_input("let f = (a) => { (b) => { a + b } }");
+  ast::func_ptr outer = first_function(program);
+  auto inner = std::dynamic_pointer_cast<ast::Function>(outer->body->nodes[0]);
+  auto sum = std::dynamic_pointer_cast<ast::Infix>(inner->body->nodes[0]);
+  auto a = std::dynamic_pointer_cast<ast::Identifier>(sum->left);
+  auto b = std::dynamic_pointer_cast<ast::Identifier>(sum->right);
+
+  ASSERT_EQ(a->depth, 1);
+  ASSERT_EQ(a->slot, 0);
+  ASSERT_EQ(b->depth, 0);
+  ASSERT_EQ(b->slot, 0);
+}
+
+TEST(Resolver, MatchesLookupByName) {
+  struct test_suite {
+    std::string input;
+    int64_t expected;
+  };
+
+  test_suite tests[] = {
+      // The right side still sees the outer x
+      {"let x = 1\nlet f = () => { let x = x + 1\nx }\nf() + x", 3},
+      // Locals declared after a closure is made are visible once it runs
+      {"let f = () => {\nlet g = () => { y }\nlet y = 4\ng()\n}\nf()", 4},
+      {"let f = (n) => {\nlet total = 0\n"
+       "each(1..n, (x) => { total = total + x })\ntotal\n}\nf(5)",
+       15},
+      {"let fib = (n) => {\nif (n < 2) { return n }\n"
+       "fib(n - 1) + fib(n - 2)\n}\nfib(10)",
+       55}};
+
+  for (auto &test : tests) {
+    env::env_ptr envir = env::env_ptr(new env::Environment());
+    obj::obj_ptr result = eval(resolve_input(test.input), envir);
+    ASSERT_EQ(result->_type(), obj::INTEGER) << "Failed on " << test.input;
+    ASSERT_EQ(std::dynamic_pointer_cast<obj::Integer>(result)->value,
+              test.expected)
+        << "Failed on " << test.input;
+  }
+}
+
+TEST(Resolver, ShadowedUntilDeclared) {
+  struct test_suite {
+    std::string input;
+    int64_t expected;
+  };
+
+  test_suite tests[] = {
+      // The inner x isn't there yet when get() runs, so it sees the global
+      {"let x = 1\nlet outer = () => {\nlet get = () => { x }\n"
+       "let r = get()\nlet x = 2\nr\n}\nouter()",
+       1},
+      // or the nearest enclosing function's
+      {"let f = (x) => {\nlet g = () => {\nlet get = () => { x }\n"
+       "let r = get()\nlet x = 2\nr\n}\ng()\n}\nf(3)",
+       3},
+      // and the same goes for assigning to it
+      {"let x = 1\nlet outer = () => {\nlet put = () => { x = 5 }\n"
+       "put()\nlet x = 2\nx\n}\nouter() + x",
+       7}};
+
+  for (auto &test : tests) {
+    for (bool use_vm : {false, true}) {
+      Interpreter interpreter;
+      obj::obj_ptr result =
+          interpreter.run(Program::compile(test.input, use_vm));
+      ASSERT_EQ(result->_type(), obj::INTEGER) << "Failed on " << test.input;
+      ASSERT_EQ(std::dynamic_pointer_cast<obj::Integer>(result)->value,
+                test.expected)
+          << "Failed on " << test.input;
+    }
+  }
+}
@@ -0,0 +1,92 @@
+#include "sampler.h"
+#include <gtest/gtest.h>
+#include <sstream>
+#include <string>
+#include "interpreter.h"
+#include "parth_error.h"
+
+TEST(Sampler, AttributesSamplesToFunctionsAndLines) {
+  for (bool use_vm : {false, true}) {
+    Interpreter interpreter;
+    program_ptr program = Program::compile(
+        "let fib = (n) => {\nif (n < 2) { return n }\n"
+        "fib(n - 1) + fib(n - 2)\n}\nfib(18)",
+        use_vm);
+
+    // The timer only counts CPU time, so run until there's enough of it
+    sample::start(1000);
+    for (int i = 0; i < 200 && sample::sample_count() < 20; i++) {
+      interpreter.execute(program, bindings());
+    }
+    sample::stop();
+    ASSERT_FALSE(sample::running());
+    ASSERT_GT(sample::sample_count(), 0u);
+
+    std::ostringstream folded;
+    sample::write_folded(folded);
+    // fib is called from line 5, and the time in it is on lines 2 and 3
+    ASSERT_NE(folded.str().find("main:5;fn@1:10:"), std::string::npos)
+        << (use_vm ? "On the VM\n" : "") << folded.str();
+    ASSERT_EQ(folded.str().find("fn@1:10:4"), std::string::npos)
+        << (use_vm ? "On the VM\n" : "") << folded.str();
+  }
+}
+
+TEST(Sampler, StackUnwindsWithExceptions) {
+  Interpreter interpreter;
+  ASSERT_THROW(interpreter.run("let f = () => { len(missing) }\nf()"),
+               NoVarException);
+  ASSERT_EQ(sample::call_stack().depth.load(), 1u);
+
+  interpreter.run("let g = (x) => { x }\nmap(1..3, g)");
+  ASSERT_EQ(sample::call_stack().depth.load(), 1u);
+
+  program_ptr program =
+      Program::compile("let h = () => { missing }\nh()", true);
+  ASSERT_THROW(interpreter.execute(program, bindings()), NoVarException);
+  ASSERT_EQ(sample::call_stack().depth.load(), 1u);
+}
+
+TEST(Sampler, CountsWhatDoesNotFit) {
+  Interpreter interpreter;
+  program_ptr program = Program::compile(
+      "let f = (n) => { n * 2 }\nlen(map(1..2000, f))");
+
+  sample::start(1000, 1);
+  for (int i = 0; i < 1000 && sample::dropped() == 0; i++) {
+    interpreter.execute(program, bindings());
+  }
+  sample::stop();
+  ASSERT_EQ(sample::sample_count(), 1u);
+  ASSERT_GT(sample::dropped(), 0u);
+}
+
+TEST(Sampler, CountsStacksThatDoNotFit) {
+  Interpreter interpreter;
+  // Nearly all the time is spent 20 calls deep, more than the 16 frames a
+  // sample gets on average
+  program_ptr program = Program::compile(
+      "let g = (x) => { x * 2 }\n"
+      "let f = (n) => {\n"
+      "if (n > 0) { return f(n - 1) }\n"
+      "len(map(1..2000, g))\n"
+      "}\n"
+      "f(20)");
+
+  sample::start(1000, 100);
+  for (int i = 0; i < 1000 && sample::dropped() == 0; i++) {
+    interpreter.execute(program, bindings());
+  }
+  sample::stop();
+  ASSERT_GT(sample::dropped(), 0u);
+  ASSERT_LT(sample::sample_count(), 100u);
+
+  std::ostringstream folded;
+  sample::write_folded(folded);
+  size_t written = 0;
+  std::istringstream lines(folded.str());
+  for (std::string line; std::getline(lines, line);) {
+    written += std::stoul(line.substr(line.rfind(' ') + 1));
+  }
+  ASSERT_EQ(written, sample::sample_count());
+}
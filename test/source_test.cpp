@@ -0,0 +1,40 @@
+#include "source.h"
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include "parth_error.h"
+
+static std::string write_temp(const std::string &name,
+                              const std::string &contents) {
+  std::string path = testing::TempDir() + name;
+  std::ofstream out(path, std::ios::binary);
+  out << contents;
+  return path;
+}
+
+TEST(Source, MapsTheWholeFile) {
+  std::string contents = "let a = 1\nprint(a)\n";
+  std::string path = write_temp("parth_source_test.parth", contents);
+
+  {
+    SourceFile source = SourceFile(path);
+    ASSERT_EQ(source.text(), contents);
+    ASSERT_EQ(source.get_path(), path);
+  }
+  std::remove(path.c_str());
+}
+
+TEST(Source, EmptyFile) {
+  std::string path = write_temp("parth_source_empty.parth", "");
+
+  {
+    SourceFile source = SourceFile(path);
+    ASSERT_TRUE(source.text().empty());
+  }
+  std::remove(path.c_str());
+}
+
+TEST(Source, MissingFileThrows) {
+  ASSERT_THROW(SourceFile("/no/such/script.parth"), SourceException);
+}
@@ -0,0 +1,65 @@
+#include "symbol.h"
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+#include "ast.h"
+#include "lexer.h"
+#include "parser.h"
+#include "token.h"
+
+TEST(Symbol, InternIsStable) {
+  symbol_id first = SymbolTable::intern("some_name");
+  symbol_id second = SymbolTable::intern(std::string("some_") + "name");
+  ASSERT_EQ(first, second);
+  ASSERT_NE(first, SymbolTable::intern("some_other_name"));
+  ASSERT_EQ(SymbolTable::name(first), "some_name");
+}
+
+TEST(Symbol, IdentTokensShareSymbols) {
+  Lexer lexer = Lexer("let abc = abc + 1");
+  std::vector<Token> tokens;
+  for (Token tok = lexer.next_token();
+       tok.get_type() != TokenType::EOF_VAL; tok = lexer.next_token()) {
+    tokens.push_back(tok);
+  }
+
+  ASSERT_EQ(tokens.size(), 6u);
+  ASSERT_EQ(tokens[1].get_symbol(), tokens[3].get_symbol());
+  ASSERT_EQ(tokens[1].get_symbol(), SymbolTable::intern("abc"));
+  ASSERT_EQ(tokens[0].get_symbol(), Token::NO_SYMBOL)
+      << "Keywords don't need to be interned";
+}
+
+TEST(Symbol, LiteralsArentInterned) {
+  Lexer lexer = Lexer("abc + \"some text\" + 12");
+  std::vector<Token> tokens;
+  for (Token tok = lexer.next_token();
+       tok.get_type() != TokenType::EOF_VAL; tok = lexer.next_token()) {
+    tokens.push_back(tok);
+  }
+
+  ASSERT_NE(tokens[0].get_symbol(), Token::NO_SYMBOL);
+  ASSERT_EQ(tokens[2].get_symbol(), Token::NO_SYMBOL);
+  ASSERT_EQ(tokens[2].get_literal(), "some text");
+  ASSERT_EQ(tokens[4].get_symbol(), Token::NO_SYMBOL);
+  ASSERT_EQ(tokens[4].get_literal(), "12");
+}
+
+TEST(Symbol, TreeOutlivesItsSource) {
+  ast::block_ptr program;
+  {
+    std::string input = "let long_lived = \"some text\" + 12";
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(&lexer);
+    program = parser.parse_program();
+    // Scribbling over the input shouldn't reach the tree
+    input.assign(input.size(), '#');
+  }
+
+  auto let = std::dynamic_pointer_cast<ast::Let>(program->nodes[0]);
+  ASSERT_EQ(let->expression->to_string(), "(\"some text\" + 12)");
+  ASSERT_EQ(let->name->token_literal(), "long_lived");
+  auto infix = std::dynamic_pointer_cast<ast::Infix>(let->expression);
+  ASSERT_EQ(infix->left->token_literal(), "some text");
+  ASSERT_EQ(infix->right->token_literal(), "12");
+}
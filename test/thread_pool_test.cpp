@@ -0,0 +1,59 @@
+#include "thread_pool.h"
+#include <gtest/gtest.h>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(ThreadPool, RunsEveryIndexOnce) {
+  ThreadPool pool(4);
+  std::vector<std::atomic<int>> hits(10000);
+  for (auto &hit : hits) {
+    hit.store(0);
+  }
+
+  pool.parallel_for(hits.size(), 7, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      hits[i].fetch_add(1);
+    }
+  });
+
+  for (size_t i = 0; i < hits.size(); i++) {
+    ASSERT_EQ(hits[i].load(), 1) << "Index " << i;
+  }
+}
+
+TEST(ThreadPool, SmallLoopsRunInline) {
+  ThreadPool pool(2);
+  std::vector<size_t> seen;
+  pool.parallel_for(5, 10, [&](size_t begin, size_t end) {
+    seen.push_back(begin);
+    seen.push_back(end);
+  });
+  ASSERT_EQ(seen, (std::vector<size_t>{0, 5}));
+}
+
+TEST(ThreadPool, RethrowsFromAChunk) {
+  ThreadPool pool(4);
+  std::atomic<size_t> ran(0);
+  ASSERT_THROW(pool.parallel_for(100, 1,
+                                 [&](size_t begin, size_t) {
+                                   ran.fetch_add(1);
+                                   if (begin == 42) {
+                                     throw std::runtime_error("chunk 42");
+                                   }
+                                 }),
+               std::runtime_error);
+  // The rest still ran before it was rethrown
+  ASSERT_EQ(ran.load(), 100u);
+}
+
+TEST(ThreadPool, NestedLoops) {
+  ThreadPool pool(3);
+  std::atomic<size_t> total(0);
+  pool.parallel_for(20, 1, [&](size_t, size_t) {
+    pool.parallel_for(50, 5, [&](size_t begin, size_t end) {
+      total.fetch_add(end - begin);
+    });
+  });
+  ASSERT_EQ(total.load(), 1000u);
+}
@@ -0,0 +1,45 @@
+#include "value.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include "builtin.h"
+#include "object.h"
+
+using namespace obj;
+
+TEST(Value, Inline) {
+  Value num = Value::integer(42);
+  ASSERT_TRUE(num.is_int());
+  ASSERT_EQ(num.type(), INTEGER);
+  ASSERT_EQ(num.as_int(), 42);
+  ASSERT_EQ(num.object(), nullptr) << "Numbers shouldn't hold an object";
+
+  Value b = Value::boolean(true);
+  ASSERT_TRUE(b.is_bool());
+  ASSERT_EQ(b.box(), TRUE_OBJ) << "Bools should box to the singletons";
+
+  ASSERT_EQ(Value::none().box(), NONE_OBJ);
+  ASSERT_TRUE(Value().is_empty());
+  ASSERT_EQ(Value().box(), nullptr);
+}
+
+TEST(Value, Boxing) {
+  obj_ptr boxed = Value::integer(7).box();
+  ASSERT_EQ(boxed->_type(), INTEGER);
+  ASSERT_EQ(std::dynamic_pointer_cast<Integer>(boxed)->value, 7);
+}
+
+TEST(Value, KeepsIdentity) {
+  int_ptr int_obj = int_ptr(new Integer(9));
+  Value from_int = Value(int_obj);
+  ASSERT_TRUE(from_int.is_int()) << "Integers should be unpacked";
+  ASSERT_EQ(from_int.as_int(), 9);
+  ASSERT_EQ(from_int.box(), int_obj) << "Boxing should give back the object";
+
+  arr_ptr list = arr_ptr(new List(obj_list{int_obj}));
+  Value from_list = Value(list);
+  ASSERT_TRUE(from_list.is_object());
+  ASSERT_EQ(from_list.type(), LIST);
+  ASSERT_EQ(from_list.box(), list);
+
+  ASSERT_TRUE(Value(obj_ptr(NONE_OBJ)).is_none());
+}
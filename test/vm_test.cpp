@@ -0,0 +1,134 @@
+#include "vm.h"
+#include <gtest/gtest.h>
+#include <memory>
+#include "ast.h"
+#include "eval.h"
+#include "lexer.h"
+#include "object.h"
+#include "parser.h"
+
+obj::obj_ptr test_vm(const std::string &input) {
+  Lexer lexer = Lexer(input);
+  Parser parser = Parser(&lexer);
+  ast::block_ptr program = parser.parse_program();
+  env::env_ptr envir = env::env_ptr(new env::Environment());
+  return vm::run(program, envir);
+}
+
+// The VM has to agree with eval() on everything, so these mirror the eval
+// tests before moving on to what only a full program can show
+
+TEST(VM, IntEval) {
+  struct test_suite {
+    std::string input;
+    int64_t expected;
+  };
+
+  test_suite tests[] = {{"5", 5},
+                        {"10", 10},
+                        {"-5", -5},
+                        {"-10", -10},
+                        {"5 + 5 + 5 + 5 - 10", 10},
+                        {"2 * 2 * 2 * 2 * 2", 32},
+                        {"-50 + 100 + -50", 0},
+                        {"5 * 2 + 10", 20},
+                        {"5 + 2 * 10", 25},
+                        {"20 + 2 * -10", 0},
+                        {"50 / 2 * 2 + 10", 60},
+                        {"2 * (5 + 10)", 30},
+                        {"3 * 3 * 3 + 10", 37},
+                        {"3 * (3 * 3) + 10", 37},
+                        {"(5 + 10 * 2 + 15 / 3) * 2 + -10", 50}};
+
+  int iterations = sizeof(tests) / sizeof(tests[0]);
+  for (int i = 0; i < iterations; i++) {
+    test_suite cur_test = tests[i];
+    obj::obj_ptr vm_obj = test_vm(cur_test.input);
+    ASSERT_EQ(vm_obj->_type(), obj::INTEGER);
+    obj::int_ptr vm_int = std::dynamic_pointer_cast<obj::Integer>(vm_obj);
+    ASSERT_EQ(cur_test.expected, vm_int->value)
+        << "Failed on " << cur_test.input;
+  }
+}
+
+TEST(VM, BoolEval) {
+  struct test_suite {
+    std::string input;
+    bool expected;
+  };
+
+  test_suite tests[] = {{"true", true},
+                        {"false", false},
+                        {"1 < 2", true},
+                        {"1 > 2", false},
+                        {"1 == 1", true},
+                        {"1 != 2", true},
+                        {"true == false", false},
+                        {"true != false", true},
+                        {"(1 < 2) == true", true},
+                        {"(1 > 2) == false", true},
+                        {"!true", false},
+                        {"!5", false},
+                        {"!!5", true},
+                        {"!0", true},
+                        {"1 && 0", false},
+                        {"1 || 0", true}};
+
+  int iterations = sizeof(tests) / sizeof(tests[0]);
+  for (int i = 0; i < iterations; i++) {
+    test_suite cur_test = tests[i];
+    obj::obj_ptr vm_obj = test_vm(cur_test.input);
+    ASSERT_EQ(vm_obj->_type(), obj::BOOLEAN);
+    obj::bool_ptr vm_bool = std::dynamic_pointer_cast<obj::Bool>(vm_obj);
+    ASSERT_EQ(cur_test.expected, vm_bool->value)
+        << "Failed on " << cur_test.input;
+  }
+}
+
+TEST(VM, MatchesEval) {
+  std::string tests[] = {
+      "let x = 5\nx = x * 2\nx",
+      "let opt? = 5\nopt",
+      "let none?\nnone",
+      "[1, 2 + 3, \"four\"]",
+      "let m = { a: 1, (1 + 1): \"two\" }\nm[2]",
+      "\"ab\"[1]",
+      "(3..9)[2]",
+      "if (1 > 2) { 5 } else if (true) { 6 } else { 7 }",
+      "if (false) { 5 }",
+      "let add = (a, b) => { a + b }\nadd(2, 3)",
+      "let early = (a) => {\nif (a) { return 1 }\n2\n}\nearly(true) + early(0)",
+      "let adder = (a) => { (b) => { a + b } }\nlet add2 = adder(2)\nadd2(8)",
+      "let fib = (n) => {\nif (n < 2) { return n }\nfib(n - 1) + fib(n - 2)\n}\n"
+      "fib(15)",
+      "let total = 0\neach(1..10, (x) => { total = total + x })\ntotal",
+      "map([1, 2, 3], (x, i) => { x * i })",
+      "len(map(\"abc\", (ch) => { ch }))",
+      "return 5\n6"};
+
+  for (auto &input : tests) {
+    Lexer lexer = Lexer(input);
+    Parser parser = Parser(&lexer);
+    ast::block_ptr program = parser.parse_program();
+    env::env_ptr eval_env = env::env_ptr(new env::Environment());
+    obj::obj_ptr expected = eval(program, eval_env);
+
+    obj::obj_ptr vm_obj = test_vm(input);
+    ASSERT_EQ(expected->_type(), vm_obj->_type()) << "Failed on " << input;
+    ASSERT_EQ(expected->inspect(), vm_obj->inspect()) << "Failed on " << input;
+  }
+}
+
+TEST(VM, ClosuresRunAsBytecode) {
+  obj::obj_ptr func = test_vm("(x) => { x }");
+  ASSERT_EQ(func->_type(), obj::FUNCTION);
+  obj::func_ptr func_obj = std::dynamic_pointer_cast<obj::Function>(func);
+  ASSERT_NE(func_obj->proto, nullptr)
+      << "Functions created by the VM should carry their compiled body";
+}
+
+TEST(VM, Errors) {
+  ASSERT_THROW(test_vm("5 / 0"), DivideByZeroException);
+  ASSERT_THROW(test_vm("5(1)"), NoSuchOperatorException);
+  ASSERT_THROW(test_vm("let x = 1\nlet x = 2"), InitVarException);
+}